@@ -7,291 +7,3116 @@
  */
 
 #include "Debug.h"
+#include <stdarg.h>
+#include <ConditionalMacros.h>
+#include <Errors.h>
 #include <Files.h>
+#include <Devices.h>
+#include <Serial.h>
+#include <Gestalt.h>
+#include <Threads.h>
+#include <Memory.h>
+#include <Resources.h>
+#include <Timer.h>
+
+/* Append mode: fixed-size launch counter record at the start of the file */
+#define kDebugLaunchTag     "LAUNCHES "
+#define kDebugLaunchDigits  8
+#define kDebugLaunchLen     18      /* Tag, digits and CR */
+
+/* Buffer sizes */
+#define kDebugBufSize   4096L   /* Output buffer written with one FSWrite */
+#define kDebugHoldSize  16384L  /* Lines kept while the file can't be written */
+#define kDebugRetryTicks 300    /* Between attempts to write held lines */
+#define kDebugLineMax   256     /* Line assembly area */
+#define kDebugSeqWidth  10      /* "#", 8 hex digits and a space */
+#define kDebugMaxCheckpoints 512    /* Index entries kept until DebugClose */
+
+/* Packed file blocks: a 4-byte header, then LZSS data or the text as is */
+#define kDebugPackMagic     "DLZ1"  /* First four bytes of a packed log */
+#define kDebugPackHeader    4       /* Text length and packed length, 2 bytes each */
+#define kDebugPackSize      (kDebugBufSize + kDebugPackHeader + 4)
+#define kDebugLZHashSize    1024    /* Must be a power of two */
+#define kDebugLZMinMatch    3
+#define kDebugLZMaxMatch    18      /* 4-bit length */
+#define kDebugLZMaxOffset   4095    /* 12-bit offset */
+
+/* Deferred formatting queue */
+#define kDebugDeferSize         2048L
+#define kDebugFormatArgBytes    32      /* Raw argument bytes kept per DebugLogFormat */
+
+/* Only 68K passes variable arguments in memory, where they can be replayed */
+#if TARGET_CPU_68K
+#define kDebugCanDeferArgs  1
+#else
+#define kDebugCanDeferArgs  0
+#endif
+
+enum {
+    kDeferText = 1,     /* Copy of the message follows the record */
+    kDeferInt = 2,
+    kDeferHex = 3,
+    kDeferFormat = 4,   /* kDebugFormatArgBytes of raw arguments follow */
+    kDeferPStr = 5      /* Copy of the Pascal string follows; text is the prefix */
+};
+
+typedef struct DeferredRecord {
+    short kind;
+    short size;         /* Whole record, rounded up to a multiple of 4 */
+    short level;        /* gDebugLevel when the call was made */
+    short depth;        /* gDebugDepth then */
+    ThreadID thread;    /* Calling thread, for the thread tag */
+    const char *text;   /* Message or format */
+    long value;         /* Value, or message length for kDeferText */
+} DeferredRecord;
+
+/* Trace indentation: two spaces per level, taken from a fixed string */
+#define kDebugIndentMax     64
+static const char kDebugIndent[] =
+    "                                                                ";
+
+/* Timing table */
+#define kDebugMaxTimers     16
+#define kDebugTimerBuckets  20      /* log2 of microseconds; last is open-ended */
+#define kDebugUsecPerTick   16667L
+
+typedef struct DebugTimer {
+    const char *name;
+    unsigned long count;
+    UnsignedWide total;         /* Microseconds, in 64 bits */
+    unsigned long min;
+    unsigned long max;
+    unsigned long buckets[kDebugTimerBuckets];
+} DebugTimer;
+
+/* Output sinks; kDebugMaxSinks is in Debug.h */
+#define kDebugLevelNone     0x7FFF  /* Above every level: no sink open */
+#define kDebugLevelAll      0x7FFE  /* Header lines, taken by every sink */
+
+typedef struct DebugSinkState {
+    short kind;                 /* kDebugSinkFile etc. */
+    short minLevel;             /* Lowest level this sink takes */
+    short refNum;               /* Serial output driver; the file uses gDebugRefNum */
+    short inRefNum;             /* Serial input driver */
+    char *buf;                  /* Output buffer, or the ring itself */
+    long bufSize;
+    long bufLen;                /* Bytes waiting; for the ring, the next write offset */
+    long bufLines;
+    unsigned long bufTick;      /* When the oldest line arrived */
+    Boolean wrapped;            /* Ring: older text follows bufLen */
+    char *sendBuf;              /* Serial: buffer being sent while buf fills */
+    ParamBlockRec pb;           /* Serial: asynchronous write in progress */
+    DebugSinkProc proc;         /* Callback */
+    void *refCon;
+} DebugSinkState;
+
+/* Thread Manager: lines from different threads are assembled apart */
+#define kDebugMaxThreads    8
+
+typedef struct DebugLineSlot {
+    ThreadID thread;            /* Owner, kNoThreadID when free */
+    short len;
+    Boolean spilled;            /* Part already committed */
+    const char *source;         /* Constant message text, if any */
+    short sourceAt;             /* Where it starts in the line */
+    short level;                /* Sinks below this level don't get it */
+    Boolean stamp;              /* Sequence number not given out yet */
+    char text[kDebugLineMax];
+} DebugLineSlot;
 
 /* Private state */
+static unsigned char gDebugFileName[256];
+static long gDebugFileSize = 0;     /* Bytes in the file, for rotation */
+static long gDebugFileText = 0;     /* Text written, before any packing */
+
+/* Checkpoints: where each checkpoint line went, for the index file */
+typedef struct DebugCheckpoint {
+    unsigned long tick;
+    unsigned long seq;
+    long offset;                /* Text offset of the line in the log */
+} DebugCheckpoint;
+
+static DebugCheckpoint *gDebugChecks = nil;
+static short gDebugCheckCount = 0;
+static unsigned long gDebugCheckTicks = 0;     /* Interval; doubles when the table fills */
+static unsigned long gDebugCheckTick = 0;      /* Last checkpoint */
+
+/* Held lines: kept in memory while the file can't be written */
+static Boolean gDebugFileFailed = false;
+static char *gDebugHold = nil;
+static long gDebugHoldLen = 0;
+static unsigned long gDebugHoldLines = 0;
+static unsigned long gDebugHeldTotal = 0;   /* Since the failure */
+static unsigned long gDebugLostLines = 0;   /* Since the failure */
+static unsigned long gDebugRetryTick = 0;
+static unsigned long gDebugLaunches = 0;
+
+/* Packing: a fixed table and output block, allocated when the file opens */
+static short gDebugLZTable[kDebugLZHashSize];  /* Last position seen per hash */
+static char *gDebugPack = nil;
 static short gDebugRefNum = 0;
+static short gDebugVRefNum = 0;
 static Boolean gDebugEnabled = false;
+static DebugConfig gDebugConfig;
+
+/* Sinks: entry 0 is the one DebugInitEx opens */
+static DebugSinkState gDebugSinks[kDebugMaxSinks];
+static short gDebugSinkCount = 0;
+
+/* Levels: public so DEBUG_WANTS can check them inline */
+short gDebugMinLevel = kDebugLevelNone;         /* Lowest level any sink takes */
+short gDebugLevel = kDebugLevelInfo;            /* Level given to new lines */
+
+/* Lines being assembled: one slot per thread part way through a line */
+static DebugLineSlot gDebugSlots[kDebugMaxThreads];
+static DebugLineSlot *gDebugCur = &gDebugSlots[0];     /* The running thread's */
+static Boolean gDebugThreads = false;                   /* Thread Manager present */
+static ThreadID gDebugCommitOwner = kNoThreadID;        /* Thread adding to the sinks */
+static short gDebugCommitDepth = 0;
+static unsigned long gDebugSeq = 0;                     /* Last sequence number used */
+
+/* Duplicate coalescing: the last committed line */
+static const char *gDebugPrevSource = nil;
+static short gDebugPrevSourceAt = 0;
+static long gDebugPrevLen = -1;
+static char gDebugPrevText[kDebugLineMax];
+static unsigned long gDebugPrevHash = 0;
+static unsigned long gDebugRepeats = 0;
+static short gDebugPrevLevel = kDebugLevelInfo;
+
+/* Timing */
+static DebugTimer gDebugTimers[kDebugMaxTimers];
+static short gDebugTimerCount = 0;
+static short gDebugClock = 0;   /* 0 = not checked, 1 = Microseconds, 2 = ticks */
+
+/* Tracing */
+static short gDebugDepth = 0;
+
+/* Metrics: values are public so the Debug.h macros can update them inline */
+long gDebugMetrics[kDebugMaxMetrics + 1];
+static long gDebugMetricPrev[kDebugMaxMetrics];
+static const char *gDebugMetricNames[kDebugMaxMetrics];
+static short gDebugMetricKinds[kDebugMaxMetrics];
+static short gDebugMetricCount = 0;
+static unsigned long gDebugMetricsTick = 0;     /* Last periodic snapshot */
+
+/* Deferred records, rendered by DrainDeferred */
+static long gDebugDeferQueue[kDebugDeferSize / sizeof(long)];
+static long gDebugDeferLen = 0;
+static Boolean gDebugDraining = false;
+static ThreadID gDebugDrainThread = kNoThreadID;        /* Thread of the record being drawn */
+
+static void DrainDeferred(void);
+static void WriteCheckpoint(void);
+
+/* Message table for DebugLogID, from the generated DebugStrings.c */
+static const DebugString *gDebugStrings = nil;
+static short gDebugStringCount = 0;
+
+/* The logger's own figures, for DebugGetStats */
+static DebugStats gDebugStats;
+static short gDebugInside = 0;              /* Nesting of timed logger work */
+static unsigned long gDebugInsideStart = 0;
+
+/* Memory low-water marks, sampled at each line when trackMemory is set */
+static long gDebugLowFree = 0;
+static long gDebugLowStack = 0;
 
 /* Simple strlen replacement to avoid library issues */
-static short MyStrLen(const char *str)
+static long MyStrLen(const char *str)
 {
-    short len = 0;
+    const char *end = str;
     if (str == nil) return 0;
-    while (*str != '\0' && len < 32000) {
-        len++;
-        str++;
+    while (*end != '\0') {
+        end++;
     }
-    return len;
+    return end - str;
 }
 
-/*
- * DebugInit
- * Initialize the debug log file.
- */
-Boolean DebugInit(const char *filename)
+/* Simple strcmp replacement; true when the strings match */
+static Boolean MyStrEqual(const char *a, const char *b)
 {
-    unsigned char pFilename[256];
-    OSErr err;
-    short len;
-    long count;
-    const char *headerMsg = "DEBUG LOG INITIALIZED\r";
-    
-    /* Close existing log if open */
-    if (gDebugRefNum != 0) {
-        FSClose(gDebugRefNum);
-        gDebugRefNum = 0;
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
     }
-    
-    gDebugEnabled = false;
-    
-    /* Safety check */
-    if (filename == nil) {
-        SysBeep(1); /* Beep: filename is nil */
-        return false;
+    return *a == *b;
+}
+
+/* Simple memcmp replacement; true when the bytes match */
+static Boolean MyMemEqual(const char *a, const char *b, long len)
+{
+    while (len-- > 0) {
+        if (*a++ != *b++) return false;
     }
-    
-    /* Convert C string to Pascal string manually */
-    len = MyStrLen(filename);
-    if (len > 255) len = 255;
-    pFilename[0] = (unsigned char)len;
-    {
-        short i;
-        for (i = 0; i < len; i++) {
-            pFilename[i + 1] = filename[i];
+    return true;
+}
+
+/* Simple memcpy replacement; short copies are cheaper than BlockMove */
+static void MyMemCopy(char *dst, const char *src, long len)
+{
+    while (len-- > 0) {
+        *dst++ = *src++;
+    }
+}
+
+/*
+ * FormatUnsigned
+ * Convert an unsigned value to decimal text. Returns the length.
+ *
+ * The 68000 has no 32-bit divide, so "% 10" and "/ 10" on a long are
+ * a library call each per digit. Instead, digits above the bottom
+ * four are found by subtracting powers of ten, and the bottom four
+ * (which fit in 16 bits) take one 16-bit divide and two table lookups.
+ */
+static const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static const unsigned long kPowersOfTen[] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL
+};
+
+static short FormatUnsigned(char *out, unsigned long value)
+{
+    char *p = out;
+    const char *pair;
+    unsigned short low;
+    unsigned short high;
+    short i;
+    char digit;
+
+    /* Upper digits: at most nine subtractions each */
+    if (value >= 10000UL) {
+        i = 0;
+        while (value < kPowersOfTen[i]) {
+            i++;
+        }
+        for (; i < 6; i++) {
+            digit = '0';
+            while (value >= kPowersOfTen[i]) {
+                value -= kPowersOfTen[i];
+                digit++;
+            }
+            *p++ = digit;
         }
+
+        /* All four lower digits, zeros included */
+        low = (unsigned short)value;
+        high = low / 100;
+        low -= high * 100;
+        pair = &kDigitPairs[high * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+        pair = &kDigitPairs[low * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+        return (short)(p - out);
     }
-    
-    /* Delete old file (ignore errors) */
-    FSDelete(pFilename, 0);
-    
-    /* Create the file */
-    err = Create(pFilename, 0, 'ttxt', 'TEXT');
-    if (err != noErr) {
-        SysBeep(2); /* Beep: Create failed */
-        return false;
+
+    /* Below 10000: no leading zeros */
+    low = (unsigned short)value;
+    high = low / 100;
+    low -= high * 100;
+    if (high != 0) {
+        pair = &kDigitPairs[high * 2];
+        if (high >= 10) *p++ = pair[0];
+        *p++ = pair[1];
+        pair = &kDigitPairs[low * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+    } else {
+        pair = &kDigitPairs[low * 2];
+        if (low >= 10) *p++ = pair[0];
+        *p++ = pair[1];
     }
-    
-    /* Open the file */
-    err = FSOpen(pFilename, 0, &gDebugRefNum);
-    if (err != noErr) {
-        SysBeep(3); /* Beep: FSOpen failed */
-        gDebugRefNum = 0;
-        return false;
+    return (short)(p - out);
+}
+
+/*
+ * FormatDecimal
+ * Convert a signed value to decimal text. Returns the length.
+ */
+static short FormatDecimal(char *out, long value)
+{
+    if (value < 0) {
+        out[0] = '-';
+        return 1 + FormatUnsigned(out + 1, -(unsigned long)value);
     }
-    
-    /* Enable debug logging */
-    gDebugEnabled = true;
-    
-    /* Write header */
-    count = MyStrLen(headerMsg);
-    err = FSWrite(gDebugRefNum, &count, headerMsg);
-    if (err != noErr) {
-        SysBeep(4); /* Beep: FSWrite failed */
-        FSClose(gDebugRefNum);
-        gDebugRefNum = 0;
-        gDebugEnabled = false;
-        return false;
+    return FormatUnsigned(out, (unsigned long)value);
+}
+
+/*
+ * DivideWide
+ * Divide a 64-bit value in place, by shifting and subtracting, so no
+ * 64-bit library routine is needed. Returns the remainder. Only used
+ * by reports, where speed doesn't matter.
+ */
+static unsigned long DivideWide(UnsignedWide *value, unsigned long divisor)
+{
+    unsigned long rem = 0;
+    unsigned long carry;
+    short bit;
+
+    for (bit = 0; bit < 64; bit++) {
+        carry = rem & 0x80000000UL;
+        rem = (rem << 1) | (value->hi >> 31);
+        value->hi = (value->hi << 1) | (value->lo >> 31);
+        value->lo <<= 1;
+        if (carry != 0 || rem >= divisor) {
+            rem -= divisor;
+            value->lo |= 1;
+        }
     }
-    
-    /* Success beep */
-    SysBeep(10);
-    return true;
+    return rem;
 }
 
 /*
- * DebugLog
- * Write a simple text message to the log.
+ * FormatWide
+ * Convert a 64-bit unsigned value to decimal text. Returns the length
+ * (at most 20).
  */
-void DebugLog(const char *message)
+static short FormatWide(char *out, UnsignedWide value)
 {
-    long count;
-    OSErr err;
-    const char newline = '\r';
-    short msgLen;
-    
-    /* Immediate safety checks */
-    if (!gDebugEnabled) {
-        SysBeep(5); /* Not enabled */
-        return;
+    unsigned long parts[2];
+    char numBuf[12];
+    short count = 0;
+    short len;
+    short digits;
+    short pad;
+
+    /* Nine digits at a time, lowest first */
+    while (value.hi != 0) {
+        parts[count++] = DivideWide(&value, 1000000000UL);
     }
-    
-    if (gDebugRefNum == 0) {
-        SysBeep(6); /* No file ref */
-        return;
+    len = FormatUnsigned(out, value.lo);
+    while (count-- > 0) {
+        digits = FormatUnsigned(numBuf, parts[count]);
+        for (pad = digits; pad < 9; pad++) {
+            out[len++] = '0';
+        }
+        MyMemCopy(out + len, numBuf, digits);
+        len += digits;
     }
-    
-    if (message == nil) {
-        SysBeep(7); /* Nil message */
-        return;
+    return len;
+}
+
+/*
+ * FormatHex
+ * Convert a value to hex text without leading zeros. Returns the length.
+ */
+static short FormatHex(char *out, unsigned long value, Boolean upper)
+{
+    const char *hexChars = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    short digits = 1;
+    short i;
+
+    while (digits < 8 && (value >> (digits * 4)) != 0) {
+        digits++;
     }
-    
-    /* Get message length */
-    msgLen = MyStrLen(message);
-    if (msgLen == 0) {
-        SysBeep(8); /* Empty message */
-        return;
+    for (i = digits - 1; i >= 0; i--) {
+        *out++ = hexChars[(value >> (i * 4)) & 0x0F];
     }
-    
-    /* Write message */
-    count = msgLen;
-    err = FSWrite(gDebugRefNum, &count, message);
-    if (err != noErr || count != msgLen) {
-        SysBeep(20); /* Write failed */
-        return;
+    return digits;
+}
+
+/*
+ * NoteError
+ * Count a failed File Manager or driver call. Errors are only counted,
+ * never signalled, so a failing log doesn't hold up the programme.
+ */
+static void NoteError(OSErr err)
+{
+    gDebugStats.errors++;
+    gDebugStats.lastError = err;
+}
+
+/*
+ * FileCall
+ * Count a File Manager or serial driver call. Returns its result.
+ */
+static OSErr FileCall(OSErr err)
+{
+    gDebugStats.fileCalls++;
+    return err;
+}
+
+/*
+ * EnterLogger / LeaveLogger
+ * Bracket work done by the logger so that, with timeSelf set, the
+ * time spent can be added up. Only the outermost pair is timed.
+ */
+static void EnterLogger(void)
+{
+    if (gDebugInside++ == 0 && gDebugConfig.timeSelf) {
+        gDebugInsideStart = DebugTimerBegin();
     }
-    
-    /* Write newline */
-    count = 1;
-    err = FSWrite(gDebugRefNum, &count, &newline);
-    if (err != noErr) {
-        SysBeep(21); /* Newline write failed */
-        return;
+}
+
+static void LeaveLogger(void)
+{
+    if (--gDebugInside == 0 && gDebugConfig.timeSelf) {
+        gDebugStats.usecInside += DebugTimerBegin() - gDebugInsideStart;
     }
-    
-    /* Success - no beep */
 }
 
 /*
- * DebugLogInt
- * Write a message with an integer value.
+ * PackBlock
+ * LZSS-compress one block of at most kDebugBufSize bytes. A flag byte
+ * comes before each group of eight items, lowest bit first: 0 is a
+ * literal byte, 1 a two-byte match holding a 12-bit offset back into
+ * the block and the length minus 3 in the low four bits. The hash
+ * table isn't cleared between blocks; candidates are checked byte by
+ * byte, so a stale entry only costs a missed match.
+ * Returns: packed length, or len if packing wouldn't save anything
  */
-void DebugLogInt(const char *message, long value)
+static long PackBlock(const unsigned char *src, long len, unsigned char *dst)
+{
+    long pos = 0;
+    long out = 0;
+    long flagAt = 0;
+    short bit = 8;
+    short hash;
+    short cand;
+    short offset;
+    short matchLen;
+    short maxLen;
+
+    while (pos < len) {
+        if (bit == 8) {
+            flagAt = out++;
+            dst[flagAt] = 0;
+            bit = 0;
+        }
+
+        matchLen = 0;
+        cand = 0;
+        if (pos + kDebugLZMinMatch <= len) {
+            hash = ((src[pos] << 5) ^ (src[pos + 1] << 2) ^ src[pos + 2]) &
+                   (kDebugLZHashSize - 1);
+            cand = gDebugLZTable[hash];
+            gDebugLZTable[hash] = (short)pos;
+            if (cand >= 0 && cand < pos && pos - cand <= kDebugLZMaxOffset) {
+                maxLen = kDebugLZMaxMatch;
+                if (len - pos < maxLen) maxLen = (short)(len - pos);
+                while (matchLen < maxLen && src[cand + matchLen] == src[pos + matchLen]) {
+                    matchLen++;
+                }
+            }
+        }
+
+        if (matchLen >= kDebugLZMinMatch) {
+            offset = (short)(pos - cand);
+            dst[flagAt] |= (unsigned char)(1 << bit);
+            dst[out++] = (unsigned char)(offset >> 4);
+            dst[out++] = (unsigned char)(((offset & 0x0F) << 4) | (matchLen - kDebugLZMinMatch));
+            pos += matchLen;
+        } else {
+            dst[out++] = src[pos++];
+        }
+        bit++;
+
+        /* Not worth it: the caller stores the text as it is */
+        if (out >= len) return len;
+    }
+    return out;
+}
+
+/*
+ * WriteFileData
+ * Write text to the log file: as it is, or in packed blocks when the
+ * compress option is on. A block the File Manager only half wrote is
+ * taken back out, so a packed log never ends in a broken block.
+ * Returns: the File Manager result; *written is the text written
+ */
+static OSErr WriteFileData(const char *data, long len, long *written)
 {
-    char numBuf[20];
-    short i = 0;
-    short j;
+    unsigned char *block;
+    long chunk;
+    long packed;
     long count;
     OSErr err;
-    unsigned long absVal;
-    Boolean isNeg = false;
-    const char newline = '\r';
-    short msgLen;
-    
-    if (!gDebugEnabled || gDebugRefNum == 0 || message == nil) {
-        return;
-    }
-    
-    /* Write message part */
-    msgLen = MyStrLen(message);
-    if (msgLen > 0) {
-        count = msgLen;
-        err = FSWrite(gDebugRefNum, &count, message);
-        if (err != noErr) return;
-    }
-    
-    /* Convert number to string */
-    if (value < 0) {
-        isNeg = true;
-        absVal = -value;
-    } else {
-        absVal = value;
+
+    if (gDebugPack == nil) {
+        *written = len;
+        err = FileCall(FSWrite(gDebugRefNum, written, data));
+        gDebugStats.bytes += *written;
+        gDebugFileSize += *written;
+        gDebugFileText += *written;
+        return err;
     }
-    
-    /* Build digits in reverse */
-    if (absVal == 0) {
-        numBuf[i++] = '0';
-    } else {
-        while (absVal > 0 && i < 19) {
-            numBuf[i++] = '0' + (absVal % 10);
-            absVal /= 10;
+
+    block = (unsigned char *)gDebugPack;
+    *written = 0;
+    while (len > 0) {
+        chunk = len;
+        if (chunk > kDebugBufSize) chunk = kDebugBufSize;
+
+        packed = PackBlock((const unsigned char *)data, chunk, block + kDebugPackHeader);
+        if (packed == chunk) {
+            MyMemCopy((char *)block + kDebugPackHeader, data, chunk);
         }
+        block[0] = (unsigned char)(chunk >> 8);
+        block[1] = (unsigned char)chunk;
+        block[2] = (unsigned char)(packed >> 8);
+        block[3] = (unsigned char)packed;
+
+        count = packed + kDebugPackHeader;
+        err = FileCall(FSWrite(gDebugRefNum, &count, (Ptr)block));
+        if (err != noErr) {
+            if (count > 0) FileCall(SetFPos(gDebugRefNum, fsFromMark, -count));
+            return err;
+        }
+        gDebugStats.bytes += count;
+        gDebugFileSize += count;
+        gDebugFileText += chunk;
+
+        *written += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    return noErr;
+}
+
+/*
+ * CreateLogFile
+ * Create and open a new, empty log file.
+ */
+static Boolean CreateLogFile(ConstStr255Param pFilename)
+{
+    OSErr err;
+    long count;
+
+    err = FileCall(Create(pFilename, 0, 'ttxt', 'TEXT'));
+    if (err != noErr) {
+        NoteError(err);
+        return false;
     }
-    
-    if (isNeg) {
-        numBuf[i++] = '-';
+
+    err = FileCall(FSOpen(pFilename, 0, &gDebugRefNum));
+    if (err != noErr) {
+        NoteError(err);
+        return false;
     }
-    
-    /* Write digits in correct order */
-    for (j = i - 1; j >= 0; j--) {
-        count = 1;
-        err = FSWrite(gDebugRefNum, &count, &numBuf[j]);
-        if (err != noErr) return;
+
+    /* Reserve space up front so the log stays in one piece */
+    if (gDebugConfig.openMode == kDebugOpenReuse && gDebugConfig.preallocate > 0) {
+        count = gDebugConfig.preallocate;
+        FileCall(Allocate(gDebugRefNum, &count));
     }
-    
-    /* Write newline */
-    count = 1;
-    err = FSWrite(gDebugRefNum, &count, &newline);
+    return true;
 }
 
 /*
- * DebugLogHex
- * Write a message with a hex value.
+ * WriteLaunchRecord
+ * Rewrite the append-mode launch counter in place and move to the end.
  */
-void DebugLogHex(const char *message, unsigned long value)
+static Boolean WriteLaunchRecord(void)
 {
-    char hexBuf[16];
+    char record[kDebugLaunchLen];
+    char numBuf[12];
+    short digits;
     short i;
     long count;
-    OSErr err;
-    const char newline = '\r';
-    const char hexChars[] = "0123456789ABCDEF";
-    short msgLen;
-    
-    if (!gDebugEnabled || gDebugRefNum == 0 || message == nil) {
-        return;
+
+    MyMemCopy(record, kDebugLaunchTag, kDebugLaunchLen - kDebugLaunchDigits - 1);
+    digits = FormatUnsigned(numBuf, gDebugLaunches % 100000000UL);
+    for (i = 0; i < kDebugLaunchDigits - digits; i++) {
+        record[kDebugLaunchLen - kDebugLaunchDigits - 1 + i] = '0';
+    }
+    MyMemCopy(record + kDebugLaunchLen - 1 - digits, numBuf, digits);
+    record[kDebugLaunchLen - 1] = '\r';
+
+    count = kDebugLaunchLen;
+    if (FileCall(SetFPos(gDebugRefNum, fsFromStart, 0)) != noErr ||
+        FileCall(FSWrite(gDebugRefNum, &count, record)) != noErr) {
+        return false;
     }
-    
-    /* Write message */
-    msgLen = MyStrLen(message);
-    if (msgLen > 0) {
-        count = msgLen;
-        FSWrite(gDebugRefNum, &count, message);
+    if (FileCall(SetFPos(gDebugRefNum, fsFromLEOF, 0)) != noErr ||
+        FileCall(GetFPos(gDebugRefNum, &gDebugFileSize)) != noErr) {
+        return false;
     }
-    
-    /* Write "0x" */
-    hexBuf[0] = '0';
-    hexBuf[1] = 'x';
-    count = 2;
-    FSWrite(gDebugRefNum, &count, hexBuf);
-    
-    /* Write hex digits (2 digits for byte value) */
-    hexBuf[0] = hexChars[(value >> 4) & 0x0F];
-    hexBuf[1] = hexChars[value & 0x0F];
-    count = 2;
-    FSWrite(gDebugRefNum, &count, hexBuf);
-    
-    /* Write newline */
-    count = 1;
-    FSWrite(gDebugRefNum, &count, &newline);
+    gDebugFileText = gDebugFileSize;
+    return true;
 }
 
 /*
- * DebugLogFormat
- * Not fully implemented - just logs the format string
+ * ReadLaunchRecord
+ * Read the launch counter from an append-mode log.
+ * Returns false if the file doesn't start with one.
  */
-void DebugLogFormat(const char *format, ...)
+static Boolean ReadLaunchRecord(void)
 {
-    if (format != nil) {
-        DebugLog(format);
+    char record[kDebugLaunchLen];
+    long count = kDebugLaunchLen;
+    short tagLen = kDebugLaunchLen - kDebugLaunchDigits - 1;
+    short i;
+
+    if (FileCall(SetFPos(gDebugRefNum, fsFromStart, 0)) != noErr ||
+        FileCall(FSRead(gDebugRefNum, &count, record)) != noErr ||
+        count != kDebugLaunchLen || record[kDebugLaunchLen - 1] != '\r') {
+        return false;
+    }
+    for (i = 0; i < tagLen; i++) {
+        if (record[i] != kDebugLaunchTag[i]) return false;
     }
+
+    gDebugLaunches = 0;
+    for (i = tagLen; i < kDebugLaunchLen - 1; i++) {
+        if (record[i] < '0' || record[i] > '9') return false;
+        gDebugLaunches = gDebugLaunches * 10 + (record[i] - '0');
+    }
+    return true;
 }
 
 /*
- * DebugFlush
- * No-op for Mac file I/O
+ * SideFileName
+ * Build the name of a file kept beside the log: the log's name with
+ * suffix (four characters) added, shortened if need be.
  */
-void DebugFlush(void)
+static void SideFileName(unsigned char *name, const char *suffix)
 {
+    short len = gDebugFileName[0];
+
+    if (len > 255 - 4) len = 255 - 4;
+    MyMemCopy((char *)&name[1], (const char *)&gDebugFileName[1], len);
+    MyMemCopy((char *)&name[1 + len], suffix, 4);
+    name[0] = (unsigned char)(len + 4);
 }
 
 /*
- * DebugClose
- * Close the debug log file.
+ * RotateLog
+ * Rename the log to "<name>.old" (replacing any earlier one) and
+ * carry on in a new, empty file with the same launch count.
  */
-void DebugClose(void)
+static Boolean RotateLog(void)
 {
-    long count;
-    const char *endMsg = "DEBUG LOG CLOSED\r";
-    
-    if (gDebugRefNum != 0) {
-        count = MyStrLen(endMsg);
-        FSWrite(gDebugRefNum, &count, endMsg);
-        FSClose(gDebugRefNum);
+    unsigned char oldName[256];
+
+    FileCall(FSClose(gDebugRefNum));
+    gDebugRefNum = 0;
+
+    /* The index describes the file being moved aside */
+    SideFileName(oldName, ".idx");
+    FileCall(FSDelete(oldName, 0));
+    gDebugCheckCount = 0;
+
+    SideFileName(oldName, ".old");
+    FileCall(FSDelete(oldName, 0));
+    if (FileCall(Rename(gDebugFileName, 0, oldName)) != noErr) {
+        /* Name too long for ".old": lose the old text instead */
+        FileCall(FSDelete(gDebugFileName, 0));
+    }
+
+    if (!CreateLogFile(gDebugFileName)) {
         gDebugRefNum = 0;
+        return false;
     }
-    
-    gDebugEnabled = false;
+    return WriteLaunchRecord();
+}
+
+/*
+ * WriteContinuation
+ * Start a log rotated in mid-session with a header line naming the
+ * session, so tools know the lines before it are in the .old file.
+ * Written straight to the file: it is called while a buffer is being
+ * written, when a line may be half built. Has no sequence number.
+ */
+static Boolean WriteContinuation(void)
+{
+    char header[64];
+    const char *prefix = "=== SESSION ";
+    const char *middle = " tick=";
+    const char *suffix = " continued ===\r";
+    long len;
+    long written;
+
+    len = MyStrLen(prefix);
+    MyMemCopy(header, prefix, len);
+    len += FormatUnsigned(header + len, gDebugLaunches);
+    MyMemCopy(header + len, middle, MyStrLen(middle));
+    len += MyStrLen(middle);
+    len += FormatUnsigned(header + len, TickCount());
+    MyMemCopy(header + len, suffix, MyStrLen(suffix));
+    len += MyStrLen(suffix);
+
+    return WriteFileData(header, len, &written) == noErr;
+}
+
+/*
+ * UpdateMinLevel
+ * Work out the lowest level any sink takes, so unwanted calls return
+ * before any formatting.
+ */
+static void UpdateMinLevel(void)
+{
+    short i;
+
+    gDebugMinLevel = kDebugLevelNone;
+    for (i = 0; i < gDebugSinkCount; i++) {
+        if (gDebugSinks[i].minLevel < gDebugMinLevel) {
+            gDebugMinLevel = gDebugSinks[i].minLevel;
+        }
+    }
+}
+
+/*
+ * AddSink
+ * Claim a sink table entry and its buffer.
+ * Returns nil if the table is full or there's no memory.
+ */
+static DebugSinkState *AddSink(short kind, short minLevel, long bufSize)
+{
+    DebugSinkState *sink;
+
+    if (gDebugSinkCount >= kDebugMaxSinks) return nil;
+    sink = &gDebugSinks[gDebugSinkCount];
+
+    sink->kind = kind;
+    sink->minLevel = minLevel;
+    sink->refNum = 0;
+    sink->inRefNum = 0;
+    sink->buf = nil;
+    sink->bufSize = bufSize;
+    sink->bufLen = 0;
+    sink->bufLines = 0;
+    sink->bufTick = 0;
+    sink->wrapped = false;
+    sink->sendBuf = nil;
+    sink->pb.ioParam.ioResult = noErr;
+    sink->proc = nil;
+    sink->refCon = nil;
+
+    if (bufSize > 0) {
+        sink->buf = NewPtr(bufSize);
+        if (sink->buf == nil) return nil;
+    }
+
+    gDebugSinkCount++;
+    UpdateMinLevel();
+    return sink;
+}
+
+/*
+ * FindSink
+ * Look for an open sink of the given kind.
+ */
+static DebugSinkState *FindSink(short kind)
+{
+    short i;
+
+    for (i = 0; i < gDebugSinkCount; i++) {
+        if (gDebugSinks[i].kind == kind) return &gDebugSinks[i];
+    }
+    return nil;
+}
+
+/*
+ * OpenSerialPort
+ * Open the serial drivers for a serial sink and allocate its second
+ * output buffer.
+ */
+static Boolean OpenSerialPort(DebugSinkState *sink)
+{
+    const unsigned char *inName;
+    const unsigned char *outName;
+    OSErr err;
+
+    /* Driver names as Pascal strings */
+    if (sink->kind == kDebugSinkModem) {
+        inName = (const unsigned char *)"\004.AIn";
+        outName = (const unsigned char *)"\005.AOut";
+    } else {
+        inName = (const unsigned char *)"\004.BIn";
+        outName = (const unsigned char *)"\005.BOut";
+    }
+
+    sink->sendBuf = NewPtr(sink->bufSize);
+    if (sink->sendBuf == nil) {
+        NoteError(memFullErr);
+        return false;
+    }
+
+    /* The input driver must be open before the output driver */
+    err = FileCall(OpenDriver(inName, &sink->inRefNum));
+    if (err != noErr) {
+        NoteError(err);
+        sink->inRefNum = 0;
+        return false;
+    }
+    err = FileCall(OpenDriver(outName, &sink->refNum));
+    if (err != noErr) {
+        NoteError(err);
+        FileCall(CloseDriver(sink->inRefNum));
+        sink->inRefNum = 0;
+        sink->refNum = 0;
+        return false;
+    }
+    FileCall(SerReset(sink->inRefNum, gDebugConfig.serialConfig));
+    FileCall(SerReset(sink->refNum, gDebugConfig.serialConfig));
+
+    sink->pb.ioParam.ioResult = noErr;
+    return true;
+}
+
+/*
+ * WaitSerialWrite
+ * Wait for a serial sink's asynchronous write in progress, if any.
+ * Returns: false if it failed
+ */
+static Boolean WaitSerialWrite(DebugSinkState *sink)
+{
+    while (sink->pb.ioParam.ioResult > 0) {
+        /* Completes at interrupt time */
+    }
+    return sink->pb.ioParam.ioResult == noErr;
+}
+
+/*
+ * HoldText
+ * Keep lines the file couldn't take. When the hold buffer is full, or
+ * can't be allocated, the lines are counted as lost.
+ */
+static void HoldText(const char *data, long len, unsigned long lines)
+{
+    if (gDebugHold == nil) {
+        gDebugHold = NewPtr(kDebugHoldSize);
+    }
+    if (gDebugHold == nil || gDebugHoldLen + len > kDebugHoldSize) {
+        gDebugLostLines += lines;
+        gDebugStats.dropped += lines;
+        return;
+    }
+
+    MyMemCopy(gDebugHold + gDebugHoldLen, data, len);
+    gDebugHoldLen += len;
+    gDebugHoldLines += lines;
+    gDebugHeldTotal += lines;
+    gDebugStats.held += lines;
+}
+
+/*
+ * RetryHeld
+ * Try to write the held lines, at most every kDebugRetryTicks unless
+ * now is set. On success, a line saying how many lines were held and
+ * lost follows them and normal writing resumes.
+ * Returns: true if the file is working
+ */
+static Boolean RetryHeld(Boolean now)
+{
+    char notice[80];
+    long count;
+    long len;
+    OSErr err;
+
+    if (!gDebugFileFailed) return true;
+    if (gDebugRefNum == 0) return false;
+    if (!now && TickCount() - gDebugRetryTick < kDebugRetryTicks) return false;
+    gDebugRetryTick = TickCount();
+
+    if (gDebugHoldLen > 0) {
+        err = WriteFileData(gDebugHold, gDebugHoldLen, &count);
+
+        /* Keep whatever didn't fit */
+        MyMemCopy(gDebugHold, gDebugHold + count, gDebugHoldLen - count);
+        gDebugHoldLen -= count;
+        if (err != noErr) {
+            NoteError(err);
+            return false;
+        }
+    }
+
+    len = MyStrLen("(log resumed: ");
+    MyMemCopy(notice, "(log resumed: ", len);
+    len += FormatUnsigned(notice + len, gDebugHeldTotal);
+    MyMemCopy(notice + len, " lines held, ", 13);
+    len += 13;
+    len += FormatUnsigned(notice + len, gDebugLostLines);
+    MyMemCopy(notice + len, " lost)\r", 7);
+    len += 7;
+
+    err = WriteFileData(notice, len, &count);
+    if (err != noErr) {
+        NoteError(err);
+        return false;
+    }
+
+    gDebugFileFailed = false;
+    gDebugHoldLines = 0;
+    gDebugHeldTotal = 0;
+    gDebugLostLines = 0;
+    return true;
+}
+
+/*
+ * CloseSink
+ * Close a sink's file or serial port and release its buffers.
+ */
+static void CloseSink(DebugSinkState *sink)
+{
+    long mark;
+
+    switch (sink->kind) {
+        case kDebugSinkFile:
+            /* Last chance for held lines */
+            if (gDebugFileFailed && !RetryHeld(true)) {
+                gDebugStats.dropped += gDebugHoldLines;
+            }
+            if (gDebugHold != nil) DisposePtr(gDebugHold);
+            gDebugHold = nil;
+            if (gDebugPack != nil) DisposePtr(gDebugPack);
+            gDebugPack = nil;
+            if (gDebugChecks != nil) DisposePtr((Ptr)gDebugChecks);
+            gDebugChecks = nil;
+            gDebugCheckCount = 0;
+            gDebugHoldLen = 0;
+            gDebugHoldLines = 0;
+            gDebugHeldTotal = 0;
+            gDebugLostLines = 0;
+            gDebugFileFailed = false;
+
+            if (gDebugRefNum == 0) break;
+
+            /* Drop whatever is left of the previous run's text */
+            if (gDebugConfig.openMode == kDebugOpenReuse &&
+                FileCall(GetFPos(gDebugRefNum, &mark)) == noErr) {
+                FileCall(SetEOF(gDebugRefNum, mark));
+            }
+            FileCall(FSClose(gDebugRefNum));
+            FileCall(FlushVol(nil, gDebugVRefNum));
+            gDebugRefNum = 0;
+            break;
+
+        case kDebugSinkModem:
+        case kDebugSinkPrinter:
+            if (sink->refNum == 0) break;
+
+            WaitSerialWrite(sink);
+            FileCall(KillIO(sink->refNum));
+            FileCall(CloseDriver(sink->inRefNum));
+            FileCall(CloseDriver(sink->refNum));
+            sink->refNum = 0;
+            sink->inRefNum = 0;
+            break;
+    }
+
+    if (sink->sendBuf != nil) DisposePtr(sink->sendBuf);
+    if (sink->buf != nil) DisposePtr(sink->buf);
+    sink->sendBuf = nil;
+    sink->buf = nil;
+}
+
+/*
+ * CloseAllSinks
+ * Close every sink and empty the table.
+ */
+static void CloseAllSinks(void)
+{
+    short i;
+
+    for (i = 0; i < gDebugSinkCount; i++) {
+        CloseSink(&gDebugSinks[i]);
+    }
+    gDebugSinkCount = 0;
+    UpdateMinLevel();
+}
+
+/*
+ * FlushSink
+ * Make sure written text has left the machine's buffers: FlushVol for
+ * the file, or wait for the serial port to finish sending.
+ */
+static void FlushSink(DebugSinkState *sink)
+{
+    if (sink->kind == kDebugSinkFile) {
+        FileCall(FlushVol(nil, gDebugVRefNum));
+    } else if (sink->refNum != 0) {
+        WaitSerialWrite(sink);
+    }
+}
+
+/*
+ * WriteSerialBuffer
+ * Start sending the output buffer and carry on filling the other one.
+ */
+static Boolean WriteSerialBuffer(DebugSinkState *sink)
+{
+    char *sending = sink->buf;
+    OSErr err;
+
+    /* Result of the previous write */
+    WaitSerialWrite(sink);
+    err = sink->pb.ioParam.ioResult;
+
+    sink->pb.ioParam.ioCompletion = nil;
+    sink->pb.ioParam.ioRefNum = sink->refNum;
+    sink->pb.ioParam.ioBuffer = sending;
+    sink->pb.ioParam.ioReqCount = sink->bufLen;
+    sink->pb.ioParam.ioPosMode = fsAtMark;
+    sink->pb.ioParam.ioPosOffset = 0;
+    FileCall(PBWriteAsync(&sink->pb));
+    gDebugStats.bytes += sink->bufLen;
+
+    sink->buf = sink->sendBuf;
+    sink->sendBuf = sending;
+    sink->bufLen = 0;
+    sink->bufLines = 0;
+
+    if (err != noErr) {
+        NoteError(err);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * WriteBuffer
+ * Write everything in a sink's output buffer with a single FSWrite
+ * (one packed block with the compress option),
+ * or start sending it to the serial port. The ring and callback sinks
+ * have nothing to write.
+ */
+static Boolean WriteBuffer(DebugSinkState *sink)
+{
+    long count;
+    OSErr err;
+
+    if (sink->kind == kDebugSinkRing || sink->kind == kDebugSinkCallback) {
+        return true;
+    }
+    if (sink->bufLen == 0) return true;
+    if (sink->kind != kDebugSinkFile) return WriteSerialBuffer(sink);
+
+    /* Failed earlier: no traps until the next retry is due */
+    if (gDebugFileFailed) {
+        HoldText(sink->buf, sink->bufLen, sink->bufLines);
+        sink->bufLen = 0;
+        sink->bufLines = 0;
+        return RetryHeld(false);
+    }
+
+    /* Append mode size cap */
+    if (gDebugConfig.openMode == kDebugOpenAppend && gDebugConfig.maxFileSize > 0 &&
+        gDebugFileSize + sink->bufLen > gDebugConfig.maxFileSize) {
+        if (!RotateLog() || !WriteContinuation()) {
+            gDebugEnabled = false;
+        }
+
+        /* Give the new file a checkpoint with the next line */
+        gDebugCheckTick = TickCount() - gDebugCheckTicks;
+    }
+    if (gDebugRefNum == 0) {
+        gDebugStats.dropped += sink->bufLines;
+        sink->bufLen = 0;
+        sink->bufLines = 0;
+        return false;
+    }
+
+    err = WriteFileData(sink->buf, sink->bufLen, &count);
+
+    if (err != noErr) {
+        /* Disk full or failing: keep the rest in memory and retry later */
+        NoteError(err);
+        gDebugFileFailed = true;
+        gDebugRetryTick = TickCount();
+        HoldText(sink->buf + count, sink->bufLen - count, sink->bufLines);
+        sink->bufLen = 0;
+        sink->bufLines = 0;
+        return false;
+    }
+
+    sink->bufLen = 0;
+    sink->bufLines = 0;
+    return true;
+}
+
+/*
+ * WriteAllBuffers
+ * Write every sink's output buffer.
+ * Returns: false if any write failed
+ */
+static Boolean WriteAllBuffers(void)
+{
+    Boolean ok = true;
+    short i;
+
+    for (i = 0; i < gDebugSinkCount; i++) {
+        if (!WriteBuffer(&gDebugSinks[i])) ok = false;
+    }
+    return ok;
+}
+
+/*
+ * SinkAppend
+ * Pass text to one sink: into its output buffer (writing it out
+ * whenever it fills), into the ring, or to the callback.
+ */
+static void SinkAppend(DebugSinkState *sink, const char *data, long len)
+{
+    long space;
+    DebugLineSlot *slot;
+
+    if (sink->kind == kDebugSinkCallback) {
+        /* The callback may yield, and other threads' lines move gDebugCur */
+        slot = gDebugCur;
+        (*sink->proc)(data, len, sink->refCon);
+        gDebugCur = slot;
+        return;
+    }
+
+    while (len > 0) {
+        space = sink->bufSize - sink->bufLen;
+        if (space == 0) {
+            if (sink->kind == kDebugSinkRing) {
+                /* Wrap round over the oldest text */
+                sink->bufLen = 0;
+                sink->wrapped = true;
+            } else {
+                WriteBuffer(sink);
+            }
+            continue;
+        }
+        if (space > len) space = len;
+        MyMemCopy(sink->buf + sink->bufLen, data, space);
+        sink->bufLen += space;
+        data += space;
+        len -= space;
+    }
+
+    if (sink->kind != kDebugSinkRing && sink->bufLen > gDebugStats.bufHighWater) {
+        gDebugStats.bufHighWater = sink->bufLen;
+    }
+}
+
+/*
+ * WaitForThread
+ * Let another thread run, then point gDebugCur back at this thread's
+ * line slot; the other thread's lines will have moved it.
+ */
+static void WaitForThread(ThreadID other)
+{
+    DebugLineSlot *slot = gDebugCur;
+
+    if (other != kNoThreadID) {
+        YieldToThread(other);
+    } else {
+        YieldToAnyThread();
+    }
+    gDebugCur = slot;
+}
+
+/*
+ * LockCommit / UnlockCommit
+ * Keep other threads out of the sinks while one adds a line, so a
+ * callback sink that yields can't let another thread's text in part
+ * way through. Nests; does nothing without the Thread Manager.
+ */
+static void LockCommit(void)
+{
+    ThreadID me;
+
+    if (!gDebugThreads) return;
+
+    if (GetCurrentThread(&me) != noErr) me = kApplicationThreadID;
+    while (gDebugCommitOwner != kNoThreadID && gDebugCommitOwner != me) {
+        WaitForThread(gDebugCommitOwner);
+    }
+    gDebugCommitOwner = me;
+    gDebugCommitDepth++;
+}
+
+static void UnlockCommit(void)
+{
+    if (!gDebugThreads || gDebugCommitDepth == 0) return;
+
+    if (--gDebugCommitDepth == 0) {
+        gDebugCommitOwner = kNoThreadID;
+    }
+}
+
+/*
+ * DispatchText
+ * Pass part of a line to every sink that takes its level.
+ */
+static void DispatchText(const char *data, long len)
+{
+    short i;
+
+    LockCommit();
+    for (i = 0; i < gDebugSinkCount; i++) {
+        if (gDebugCur->level >= gDebugSinks[i].minLevel) {
+            SinkAppend(&gDebugSinks[i], data, len);
+        }
+    }
+    UnlockCommit();
+}
+
+/*
+ * ApplyFlushPolicy
+ * Decide whether a sink's output buffer should be written now.
+ */
+static void ApplyFlushPolicy(DebugSinkState *sink)
+{
+    Boolean due = false;
+
+    if (sink->kind == kDebugSinkRing || sink->kind == kDebugSinkCallback) {
+        return;
+    }
+
+    switch (gDebugConfig.flushPolicy) {
+        case kDebugFlushEveryLine:
+            if (WriteBuffer(sink)) {
+                FlushSink(sink);
+            }
+            return;
+
+        case kDebugFlushEveryN:
+            if (gDebugConfig.flushLines > 0 &&
+                sink->bufLines >= gDebugConfig.flushLines) {
+                due = true;
+            } else if (gDebugConfig.flushBytes > 0 &&
+                       sink->bufLen >= gDebugConfig.flushBytes) {
+                due = true;
+            } else if (gDebugConfig.flushTicks > 0 &&
+                       TickCount() - sink->bufTick >= gDebugConfig.flushTicks) {
+                due = true;
+            }
+            if (due) WriteBuffer(sink);
+            return;
+
+        default:
+            /* kDebugFlushOnClose: wait for a full buffer, DebugFlush or DebugClose */
+            return;
+    }
+}
+
+/*
+ * CommitLine
+ * Hand a complete line, formatted once, to every sink that takes its
+ * level and apply the flush policy to each.
+ */
+static void CommitLine(const char *line, long len)
+{
+    DebugSinkState *sink;
+    short i;
+
+    LockCommit();
+    gDebugStats.lines++;
+    for (i = 0; i < gDebugSinkCount; i++) {
+        sink = &gDebugSinks[i];
+        if (gDebugCur->level < sink->minLevel) continue;
+
+        if (sink->bufLines == 0) {
+            sink->bufTick = TickCount();
+        }
+        SinkAppend(sink, line, len);
+        sink->bufLines++;
+
+        ApplyFlushPolicy(sink);
+    }
+    UnlockCommit();
+}
+
+/*
+ * FlushRepeats
+ * Write the "repeated" summary for any coalesced duplicates.
+ */
+static void FlushRepeats(void)
+{
+    char summary[48];
+    const char *prefix = "(last message repeated ";
+    const char *suffix = " times)\r";
+    long len;
+    short level;
+
+    if (gDebugRepeats == 0) return;
+
+    len = MyStrLen(prefix);
+    MyMemCopy(summary, prefix, len);
+    len += FormatUnsigned(summary + len, gDebugRepeats);
+    MyMemCopy(summary + len, suffix, MyStrLen(suffix));
+    len += MyStrLen(suffix);
+
+    gDebugStats.suppressed += gDebugRepeats;
+    gDebugRepeats = 0;
+
+    /* Goes to the same sinks as the repeated line */
+    level = gDebugCur->level;
+    gDebugCur->level = gDebugPrevLevel;
+    CommitLine(summary, len);
+    gDebugCur->level = level;
+}
+
+/*
+ * StampLine
+ * Give the line its sequence number and, with the sequence option,
+ * fill in the space reserved at its start. Left until the line is
+ * committed, so repeats don't use up numbers. Only lines the primary
+ * sink takes are numbered, so its log has no gaps unless text is
+ * lost; any other line is marked '+' with the number before it.
+ */
+static void StampLine(void)
+{
+    static const char kHexDigits[] = "0123456789ABCDEF";
+    unsigned long seq;
+    short i;
+
+    if (!gDebugCur->stamp) return;
+    gDebugCur->stamp = false;
+
+    if (gDebugSinkCount > 0 && gDebugCur->level >= gDebugSinks[0].minLevel) {
+        seq = ++gDebugSeq;
+    } else {
+        seq = gDebugSeq;
+        if (gDebugConfig.sequence) gDebugCur->text[0] = '+';
+    }
+    if (!gDebugConfig.sequence) return;
+    for (i = kDebugSeqWidth - 2; i >= 1; i--) {
+        gDebugCur->text[i] = kHexDigits[(short)seq & 0x0F];
+        seq >>= 4;
+    }
+}
+
+/*
+ * LinePut
+ * Append text to the line being assembled. A line longer than the
+ * assembly area is passed on to the sinks in pieces.
+ */
+static void LinePut(const char *text, long len)
+{
+    long space;
+
+    while (len > 0) {
+        space = kDebugLineMax - gDebugCur->len;
+        if (space == 0) {
+            if (!gDebugCur->spilled) {
+                /* Held until LineEnd, so the pieces stay together */
+                LockCommit();
+                FlushRepeats();
+                StampLine();
+                gDebugCur->spilled = true;
+            }
+            DispatchText(gDebugCur->text, gDebugCur->len);
+            gDebugCur->len = 0;
+            continue;
+        }
+        if (space > len) space = len;
+        MyMemCopy(gDebugCur->text + gDebugCur->len, text, space);
+        gDebugCur->len += (short)space;
+        text += space;
+        len -= space;
+    }
+}
+
+/*
+ * LinePutStr / LinePutNum
+ * Shorthands used when building multi-part lines.
+ */
+static void LinePutStr(const char *text)
+{
+    LinePut(text, MyStrLen(text));
+}
+
+static void LinePutNum(unsigned long value)
+{
+    char numBuf[12];
+
+    LinePut(numBuf, FormatUnsigned(numBuf, value));
+}
+
+static void LinePutSigned(long value)
+{
+    char numBuf[12];
+
+    LinePut(numBuf, FormatDecimal(numBuf, value));
+}
+
+/*
+ * TakeLineSlot
+ * Point gDebugCur at a line slot for the calling thread. If every slot
+ * is in use, yields until another thread finishes its line. Without
+ * the Thread Manager, slot 0 is always used.
+ */
+static void TakeLineSlot(void)
+{
+    ThreadID me;
+    DebugLineSlot *freeSlot;
+    short i;
+
+    if (!gDebugThreads) return;
+
+    if (GetCurrentThread(&me) != noErr) me = kApplicationThreadID;
+    for (;;) {
+        freeSlot = nil;
+        for (i = 0; i < kDebugMaxThreads; i++) {
+            if (gDebugSlots[i].thread == me) {
+                gDebugCur = &gDebugSlots[i];
+                return;
+            }
+            if (freeSlot == nil && gDebugSlots[i].thread == kNoThreadID) {
+                freeSlot = &gDebugSlots[i];
+            }
+        }
+        if (freeSlot != nil) {
+            freeSlot->thread = me;
+            gDebugCur = freeSlot;
+            return;
+        }
+        WaitForThread(kNoThreadID);
+    }
+}
+
+/*
+ * LineBegin
+ * Start a new line in the calling thread's slot, tagged with the
+ * thread if asked and indented to the current trace depth.
+ */
+static void LineBegin(void)
+{
+    short indent;
+
+    EnterLogger();
+
+    /* Keep earlier deferred lines in order */
+    if (gDebugDeferLen > 0 && !gDebugDraining) {
+        DrainDeferred();
+    }
+
+    TakeLineSlot();
+    gDebugCur->len = 0;
+    gDebugCur->spilled = false;
+    gDebugCur->source = nil;
+    gDebugCur->sourceAt = 0;
+    gDebugCur->level = gDebugLevel;
+    gDebugCur->stamp = true;
+
+    /* Placeholder; the same for every line, so coalescing still works */
+    if (gDebugConfig.sequence) {
+        LinePut("#00000000 ", kDebugSeqWidth);
+    }
+    if (gDebugConfig.threadTags && gDebugThreads) {
+        LinePut("T", 1);
+        LinePutNum(gDebugDraining ? gDebugDrainThread : gDebugCur->thread);
+        LinePut(" ", 1);
+    }
+
+    indent = gDebugDepth * 2;
+    if (indent > kDebugIndentMax) indent = kDebugIndentMax;
+    LinePut(kDebugIndent, indent);
+}
+
+/*
+ * HashLine
+ * Cheap shift-and-add hash; avoids 32-bit multiplies on the 68000.
+ */
+static unsigned long HashLine(const char *line, long len)
+{
+    unsigned long hash = 5381;
+
+    while (len-- > 0) {
+        hash = (hash << 5) + hash + (unsigned char)*line++;
+    }
+    return hash;
+}
+
+/*
+ * IsRepeat
+ * Check whether the assembled line matches the previous one. A hash
+ * match is confirmed against a copy of that line. When both lines hold
+ * the same constant text (a DEBUG_LOG literal or a string table entry)
+ * at the same place, only the prefix before it needs comparing.
+ */
+static Boolean IsRepeat(void)
+{
+    unsigned long hash;
+    short len = gDebugCur->len;
+
+    if (gDebugCur->spilled) {
+        gDebugPrevLen = -1;
+        return false;
+    }
+
+    /* The same text at another level may go to other sinks */
+    if (gDebugCur->level != gDebugPrevLevel) {
+        gDebugPrevLen = -1;
+    }
+
+    if (len == gDebugPrevLen) {
+        if (gDebugCur->source != nil && gDebugCur->source == gDebugPrevSource &&
+            gDebugCur->sourceAt == gDebugPrevSourceAt &&
+            MyMemEqual(gDebugCur->text, gDebugPrevText, gDebugCur->sourceAt)) {
+            return true;
+        }
+
+        hash = HashLine(gDebugCur->text, len);
+        if (hash == gDebugPrevHash && MyMemEqual(gDebugCur->text, gDebugPrevText, len)) {
+            return true;
+        }
+    } else {
+        hash = HashLine(gDebugCur->text, len);
+    }
+
+    gDebugPrevSource = gDebugCur->source;
+    gDebugPrevSourceAt = gDebugCur->sourceAt;
+    gDebugPrevLen = len;
+    gDebugPrevHash = hash;
+    MyMemCopy(gDebugPrevText, gDebugCur->text, len);
+    return false;
+}
+
+/*
+ * CheckMetricsDue
+ * Write a metrics snapshot when the configured interval has passed.
+ */
+static void CheckMetricsDue(void)
+{
+    if (gDebugConfig.metricsTicks == 0) return;
+
+    if (TickCount() - gDebugMetricsTick >= gDebugConfig.metricsTicks) {
+        DebugMetricsSnapshot();
+    }
+}
+
+/*
+ * CheckCheckpointDue
+ * Write a checkpoint line when the interval has passed.
+ */
+static void CheckCheckpointDue(void)
+{
+    if (gDebugChecks == nil || gDebugCheckTicks == 0) return;
+
+    if (TickCount() - gDebugCheckTick >= gDebugCheckTicks) {
+        WriteCheckpoint();
+    }
+}
+
+/*
+ * SampleMemory
+ * Update the free heap and stack low-water marks.
+ */
+static void SampleMemory(void)
+{
+    long value;
+
+    value = FreeMem();
+    if (value < gDebugLowFree) gDebugLowFree = value;
+    value = StackSpace();
+    if (value < gDebugLowStack) gDebugLowStack = value;
+}
+
+/*
+ * LineEnd
+ * Terminate the assembled line and commit it to the sinks in one go,
+ * then give the slot back.
+ */
+static void LineEnd(void)
+{
+    const char newline = '\r';
+    Boolean spilled;
+
+    LinePut(&newline, 1);
+
+    LockCommit();
+    spilled = gDebugCur->spilled;
+    if (gDebugConfig.coalesce) {
+        if (IsRepeat()) {
+            gDebugRepeats++;
+        } else {
+            if (!gDebugCur->spilled) FlushRepeats();
+            gDebugPrevLevel = gDebugCur->level;
+            StampLine();
+            CommitLine(gDebugCur->text, gDebugCur->len);
+        }
+    } else {
+        StampLine();
+        CommitLine(gDebugCur->text, gDebugCur->len);
+    }
+    UnlockCommit();
+    if (spilled) UnlockCommit();
+
+    gDebugCur->len = 0;
+    gDebugCur->spilled = false;
+    gDebugCur->source = nil;
+    if (gDebugThreads) gDebugCur->thread = kNoThreadID;
+
+    if (gDebugConfig.trackMemory) SampleMemory();
+    CheckMetricsDue();
+    CheckCheckpointDue();
+
+    LeaveLogger();
+}
+
+/*
+ * WriteCheckpoint
+ * Write a checkpoint line giving the tick count, the line's sequence
+ * number and its offset in the log, and note it for the index. When
+ * the table is full, every other entry is dropped and the interval
+ * doubled, so a long run is still covered from end to end.
+ */
+static void WriteCheckpoint(void)
+{
+    DebugCheckpoint *entry;
+    unsigned long now;
+    long offset;
+    short i;
+
+    /* Set first: LineEnd checks again */
+    now = TickCount();
+    gDebugCheckTick = now;
+
+    LineBegin();
+    gDebugCur->level = kDebugLevelAll;
+
+    /* Nothing else may land in front of this line now */
+    FlushRepeats();
+    offset = gDebugFileText + gDebugSinks[0].bufLen;
+    if (gDebugFileFailed) offset += gDebugHoldLen;
+
+    LinePutStr("@CHECKPOINT tick=");
+    LinePutNum(now);
+    LinePutStr(" seq=");
+    LinePutNum(gDebugSeq + 1);
+    LinePutStr(" offset=");
+    LinePutSigned(offset);
+
+    if (gDebugCheckCount == kDebugMaxCheckpoints) {
+        for (i = 0; i < kDebugMaxCheckpoints / 2; i++) {
+            gDebugChecks[i] = gDebugChecks[i * 2];
+        }
+        gDebugCheckCount = kDebugMaxCheckpoints / 2;
+        gDebugCheckTicks *= 2;
+    }
+    entry = &gDebugChecks[gDebugCheckCount++];
+    entry->tick = now;
+    entry->seq = gDebugSeq + 1;
+    entry->offset = offset;
+
+    LineEnd();
+}
+
+/*
+ * WriteIndex
+ * Write the checkpoint table to "<name>.idx": "DIDX", then 12 bytes
+ * per checkpoint (tick, sequence number and offset, big-endian longs).
+ * In append mode the entries are added to the existing index.
+ */
+static void WriteIndex(void)
+{
+    unsigned char name[256];
+    short refNum;
+    long count;
+    OSErr err;
+
+    if (gDebugChecks == nil || gDebugCheckCount == 0) return;
+
+    SideFileName(name, ".idx");
+    if (gDebugConfig.openMode != kDebugOpenAppend) {
+        FileCall(FSDelete(name, 0));
+    }
+
+    err = FileCall(FSOpen(name, 0, &refNum));
+    if (err == fnfErr) {
+        err = FileCall(Create(name, 0, 'ttxt', 'BINA'));
+        if (err == noErr) err = FileCall(FSOpen(name, 0, &refNum));
+        if (err == noErr) {
+            count = 4;
+            err = FileCall(FSWrite(refNum, &count, "DIDX"));
+            if (err != noErr) FileCall(FSClose(refNum));
+        }
+    } else if (err == noErr) {
+        err = FileCall(SetFPos(refNum, fsFromLEOF, 0));
+        if (err != noErr) FileCall(FSClose(refNum));
+    }
+    if (err != noErr) {
+        NoteError(err);
+        return;
+    }
+
+    count = gDebugCheckCount * (long)sizeof(DebugCheckpoint);
+    err = FileCall(FSWrite(refNum, &count, (Ptr)gDebugChecks));
+    if (err != noErr) NoteError(err);
+    FileCall(FSClose(refNum));
+}
+
+/*
+ * DebugDefaultConfig
+ * Fill in the settings used by DebugInit.
+ */
+void DebugDefaultConfig(DebugConfig *config)
+{
+    if (config == nil) return;
+
+    config->flushPolicy = kDebugFlushEveryLine;
+    config->flushLines = 0;
+    config->flushBytes = 0;
+    config->flushTicks = 0;
+    config->coalesce = false;
+    config->metricsTicks = 0;
+    config->trackMemory = false;
+    config->binaryIDs = false;
+    config->deferFormat = false;
+    config->openMode = kDebugOpenReplace;
+    config->preallocate = 0;
+    config->maxFileSize = 0;
+    config->sink = kDebugSinkFile;
+    config->serialConfig = baud57600 + data8 + stop10 + noParity;
+    config->minLevel = kDebugLevelTrace;
+    config->timeSelf = false;
+    config->closeStats = false;
+    config->compress = false;
+    config->threadTags = false;
+    config->sequence = false;
+    config->checkpointTicks = 0;
+}
+
+/*
+ * StartAppend
+ * Count this launch and position at the end of an append-mode log.
+ */
+static Boolean StartAppend(void)
+{
+    long size;
+
+    if (FileCall(GetEOF(gDebugRefNum, &size)) != noErr) size = 0;
+
+    gDebugLaunches = 0;
+    if (size > 0 && !ReadLaunchRecord()) {
+        /* Written in another mode: keep it as the .old file */
+        if (!RotateLog()) return false;
+    } else if (gDebugConfig.maxFileSize > 0 && size > gDebugConfig.maxFileSize) {
+        if (!RotateLog()) return false;
+    }
+
+    gDebugLaunches++;
+    return WriteLaunchRecord();
+}
+
+/*
+ * OpenLogFile
+ * Open the log according to the configured open mode.
+ */
+static Boolean OpenLogFile(ConstStr255Param pFilename)
+{
+    OSErr err;
+
+    gDebugFileSize = 0;
+    gDebugFileText = 0;
+
+    if (gDebugConfig.openMode == kDebugOpenReplace) {
+        /* Delete old file (ignore errors) */
+        FileCall(FSDelete(pFilename, 0));
+        return CreateLogFile(pFilename);
+    }
+
+    /* Reuse the existing file's catalog entry; create only if missing */
+    err = FileCall(FSOpen(pFilename, 0, &gDebugRefNum));
+    if (err == fnfErr) {
+        if (!CreateLogFile(pFilename)) return false;
+        err = noErr;
+    } else if (err != noErr) {
+        NoteError(err);
+        return false;
+    } else if (gDebugConfig.openMode == kDebugOpenTruncate) {
+        err = FileCall(SetEOF(gDebugRefNum, 0));
+    } else if (gDebugConfig.openMode == kDebugOpenReuse) {
+        /* Overwrite in place, trimmed by DebugClose */
+        err = FileCall(SetFPos(gDebugRefNum, fsFromStart, 0));
+    }
+    if (err != noErr) {
+        NoteError(err);
+        FileCall(FSClose(gDebugRefNum));
+        return false;
+    }
+
+    if (gDebugConfig.openMode == kDebugOpenAppend && !StartAppend()) {
+        NoteError(ioErr);
+        if (gDebugRefNum != 0) FileCall(FSClose(gDebugRefNum));
+        return false;
+    }
+    return true;
+}
+
+/*
+ * WriteSessionHeader
+ * Start an append-mode session with the launch count, tick count and
+ * the application's 'vers' 1 short version string.
+ */
+static void WriteSessionHeader(void)
+{
+    Handle vers;
+    ConstStr255Param shortVersion;
+
+    LineBegin();
+    gDebugCur->level = kDebugLevelAll;
+    LinePutStr("=== SESSION ");
+    LinePutNum(gDebugLaunches);
+    LinePutStr(" tick=");
+    LinePutNum(TickCount());
+
+    /* 'vers' layout: numeric version (4), region code (2), short version */
+    vers = GetResource('vers', 1);
+    if (vers != nil && *vers != nil) {
+        shortVersion = (ConstStr255Param)(*vers + 6);
+        LinePutStr(" version=");
+        LinePut((const char *)&shortVersion[1], shortVersion[0]);
+    }
+
+    LinePutStr(" ===");
+    LineEnd();
+}
+
+/*
+ * DebugInit
+ * Initialize the debug log file.
+ */
+Boolean DebugInit(const char *filename)
+{
+    return DebugInitEx(filename, nil);
+}
+
+/*
+ * DebugInitEx
+ * Initialize the debug log file with explicit options.
+ */
+Boolean DebugInitEx(const char *filename, const DebugConfig *config)
+{
+    long len;
+    const char *headerMsg = "DEBUG LOG INITIALIZED";
+    DebugSinkState *sink;
+    OSErr err;
+
+    /* Close any log still open so its queued and buffered lines land */
+    DebugClose();
+
+    gDebugEnabled = false;
+    gDebugInside = 0;
+    gDebugStats.lines = 0;
+    gDebugStats.bytes = 0;
+    gDebugStats.fileCalls = 0;
+    gDebugStats.errors = 0;
+    gDebugStats.lastError = noErr;
+    gDebugStats.dropped = 0;
+    gDebugStats.suppressed = 0;
+    gDebugStats.bufHighWater = 0;
+    gDebugStats.usecInside = 0;
+    gDebugStats.held = 0;
+    gDebugDeferLen = 0;
+    gDebugDraining = false;
+    gDebugPrevSource = nil;
+    gDebugPrevLen = -1;
+    gDebugRepeats = 0;
+    gDebugSeq = 0;
+
+    /* Lines are assembled per thread when the Thread Manager is there */
+    {
+        long response;
+        short i;
+
+        gDebugThreads = Gestalt(gestaltThreadMgrAttr, &response) == noErr &&
+                        (response & (1L << gestaltThreadMgrPresent)) != 0;
+        for (i = 0; i < kDebugMaxThreads; i++) {
+            gDebugSlots[i].thread = kNoThreadID;
+            gDebugSlots[i].len = 0;
+            gDebugSlots[i].spilled = false;
+            gDebugSlots[i].source = nil;
+            gDebugSlots[i].stamp = false;
+        }
+        gDebugCur = &gDebugSlots[0];
+        gDebugCommitOwner = kNoThreadID;
+        gDebugCommitDepth = 0;
+    }
+
+    if (config != nil) {
+        gDebugConfig = *config;
+    } else {
+        DebugDefaultConfig(&gDebugConfig);
+    }
+    if (gDebugConfig.sink != kDebugSinkModem && gDebugConfig.sink != kDebugSinkPrinter) {
+        gDebugConfig.sink = kDebugSinkFile;
+    }
+
+    sink = AddSink(gDebugConfig.sink, gDebugConfig.minLevel, kDebugBufSize);
+    if (sink == nil) {
+        NoteError(memFullErr);
+        CloseAllSinks();
+        return false;
+    }
+
+    if (gDebugConfig.sink != kDebugSinkFile) {
+        /* Nothing to append to or trim */
+        gDebugConfig.openMode = kDebugOpenReplace;
+
+        if (!OpenSerialPort(sink)) {
+            CloseAllSinks();
+            return false;
+        }
+        gDebugVRefNum = 0;
+    } else {
+        /* Safety check */
+        if (filename == nil) {
+            NoteError(paramErr);
+            CloseAllSinks();
+            return false;
+        }
+
+        /* Convert C string to Pascal string manually */
+        len = MyStrLen(filename);
+        if (len > 255) len = 255;
+        gDebugFileName[0] = (unsigned char)len;
+        {
+            short i;
+            for (i = 0; i < len; i++) {
+                gDebugFileName[i + 1] = filename[i];
+            }
+        }
+
+        /* Open or create the file */
+        if (!OpenLogFile(gDebugFileName)) {
+            gDebugRefNum = 0;
+            CloseAllSinks();
+            return false;
+        }
+
+        /* Remember the volume so FlushVol can be used later */
+        if (GetVRefNum(gDebugRefNum, &gDebugVRefNum) != noErr) {
+            gDebugVRefNum = 0;
+        }
+
+        /* Packed log: fixed buffer, and the magic number goes first */
+        if (gDebugConfig.compress && gDebugConfig.openMode != kDebugOpenAppend) {
+            gDebugPack = NewPtr(kDebugPackSize);
+            if (gDebugPack == nil) {
+                /* Carry on with plain text */
+                NoteError(memFullErr);
+            } else {
+                len = kDebugPackHeader;
+                err = FileCall(FSWrite(gDebugRefNum, &len, kDebugPackMagic));
+                gDebugStats.bytes += len;
+                gDebugFileSize = len;
+                if (err != noErr) {
+                    NoteError(err);
+                    CloseAllSinks();
+                    return false;
+                }
+            }
+        }
+
+        /* Checkpoint table for the index; without it, no checkpoints */
+        if (gDebugConfig.checkpointTicks > 0) {
+            gDebugChecks = (DebugCheckpoint *)NewPtr(kDebugMaxCheckpoints *
+                                                     (long)sizeof(DebugCheckpoint));
+            if (gDebugChecks == nil) NoteError(memFullErr);
+            gDebugCheckCount = 0;
+            gDebugCheckTicks = gDebugConfig.checkpointTicks;
+            gDebugCheckTick = TickCount();
+        }
+    }
+
+    /* Enable debug logging */
+    gDebugEnabled = true;
+
+    /* Write header straight away, whatever the policy */
+    gDebugDepth = 0;
+    gDebugMetricsTick = TickCount();
+    gDebugLowFree = FreeMem();
+    gDebugLowStack = StackSpace();
+    if (gDebugConfig.openMode == kDebugOpenAppend) {
+        WriteSessionHeader();
+    }
+    LineBegin();
+    gDebugCur->level = kDebugLevelAll;
+    LinePut(headerMsg, MyStrLen(headerMsg));
+    LineEnd();
+    if (gDebugChecks != nil) WriteCheckpoint();
+    if (!WriteAllBuffers()) {
+        CloseAllSinks();
+        gDebugEnabled = false;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * RenderText / RenderInt / RenderHex
+ * Build and commit the lines for DebugLog, DebugLogInt and DebugLogHex.
+ */
+static void RenderText(const char *source, const char *text, long len)
+{
+    LineBegin();
+    gDebugCur->source = source;
+    gDebugCur->sourceAt = gDebugCur->len;
+    LinePut(text, len);
+    LineEnd();
+}
+
+static void RenderInt(const char *message, long value)
+{
+    char numBuf[12];
+
+    LineBegin();
+    LinePut(message, MyStrLen(message));
+    LinePut(numBuf, FormatDecimal(numBuf, value));
+    LineEnd();
+}
+
+static void RenderHex(const char *message, unsigned long value)
+{
+    char hexBuf[4];
+    const char hexChars[] = "0123456789ABCDEF";
+
+    LineBegin();
+    LinePut(message, MyStrLen(message));
+
+    /* "0x" and hex digits (2 digits for byte value) */
+    hexBuf[0] = '0';
+    hexBuf[1] = 'x';
+    hexBuf[2] = hexChars[(value >> 4) & 0x0F];
+    hexBuf[3] = hexChars[value & 0x0F];
+    LinePut(hexBuf, 4);
+
+    LineEnd();
+}
+
+static void RenderCPStr(const char *prefix, ConstStr255Param pstr)
+{
+    LineBegin();
+    if (prefix != nil) LinePut(prefix, MyStrLen(prefix));
+    LinePut((const char *)&pstr[1], pstr[0]);
+    LineEnd();
+}
+
+/*
+ * LinePad
+ * Append count copies of a padding character.
+ */
+static void LinePad(char pad, short count)
+{
+    while (count-- > 0) {
+        LinePut(&pad, 1);
+    }
+}
+
+/*
+ * RenderFormat
+ * Build and commit a line from a printf-style format. Handles
+ * %d %i %u %x %X %c %s %% with optional '-', '0', width and 'l'.
+ */
+static void RenderFormat(const char *format, va_list args)
+{
+    const char *p;
+    const char *run;
+    const char *text;
+    char numBuf[12];
+    long len;
+    short width;
+    Boolean leftAlign;
+    Boolean zeroPad;
+    Boolean isLong;
+
+    LineBegin();
+
+    p = format;
+    run = p;
+    while (*p != '\0') {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        /* Literal text up to the conversion */
+        LinePut(run, p - run);
+        p++;
+
+        leftAlign = false;
+        zeroPad = false;
+        isLong = false;
+        width = 0;
+        if (*p == '-') {
+            leftAlign = true;
+            p++;
+        }
+        if (*p == '0') {
+            zeroPad = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            if (width < kDebugIndentMax) width = width * 10 + (*p - '0');
+            p++;
+        }
+        if (width > kDebugIndentMax) width = kDebugIndentMax;
+        if (*p == 'l') {
+            isLong = true;
+            p++;
+        }
+
+        text = numBuf;
+        switch (*p) {
+            case 'd':
+            case 'i':
+                len = FormatDecimal(numBuf, isLong ? va_arg(args, long) :
+                                                     (long)va_arg(args, int));
+                break;
+            case 'u':
+                len = FormatUnsigned(numBuf, isLong ? va_arg(args, unsigned long) :
+                                                      (unsigned long)va_arg(args, unsigned int));
+                break;
+            case 'x':
+            case 'X':
+                len = FormatHex(numBuf, isLong ? va_arg(args, unsigned long) :
+                                                 (unsigned long)va_arg(args, unsigned int),
+                                *p == 'X');
+                break;
+            case 'c':
+                numBuf[0] = (char)va_arg(args, int);
+                len = 1;
+                break;
+            case 's':
+                text = va_arg(args, const char *);
+                if (text == nil) text = "(nil)";
+                len = MyStrLen(text);
+                break;
+            case '\0':
+                /* Stray '%' at the end */
+                LinePut("%", 1);
+                run = p;
+                continue;
+            default:
+                /* Unknown or "%%": write it as it stands */
+                numBuf[0] = *p;
+                len = 1;
+                break;
+        }
+        p++;
+        run = p;
+
+        if (!leftAlign && width > len) {
+            if (zeroPad && text == numBuf && numBuf[0] == '-') {
+                LinePut(text, 1);
+                text++;
+                len--;
+                width--;
+            }
+            LinePad(zeroPad ? '0' : ' ', width - len);
+        }
+        LinePut(text, len);
+        if (leftAlign && width > len) {
+            LinePad(' ', width - len);
+        }
+    }
+    LinePut(run, p - run);
+
+    LineEnd();
+}
+
+/*
+ * DeferAlloc
+ * Reserve a record in the deferred queue, draining it first if full.
+ * Returns nil when deferral is off or the record could never fit.
+ */
+static DeferredRecord *DeferAlloc(short kind, long extra)
+{
+    long size;
+    DeferredRecord *rec;
+
+    if (!gDebugConfig.deferFormat || gDebugDraining) return nil;
+
+    size = (sizeof(DeferredRecord) + extra + 3) & ~3L;
+    if (size > kDebugDeferSize) return nil;
+
+    if (gDebugDeferLen + size > kDebugDeferSize) {
+        DrainDeferred();
+    }
+
+    rec = (DeferredRecord *)((char *)gDebugDeferQueue + gDebugDeferLen);
+    rec->kind = kind;
+    rec->size = (short)size;
+    rec->level = gDebugLevel;
+    rec->depth = gDebugDepth;
+    rec->thread = kNoThreadID;
+    if (gDebugConfig.threadTags && gDebugThreads &&
+        GetCurrentThread(&rec->thread) != noErr) {
+        rec->thread = kApplicationThreadID;
+    }
+    gDebugDeferLen += size;
+    return rec;
+}
+
+#if kDebugCanDeferArgs
+/*
+ * ReplayFormat
+ * Render a deferred DebugLogFormat. On 68K the arguments sit in
+ * memory after the format, so the saved copy can stand in for them.
+ */
+static void ReplayFormat(DeferredRecord *rec)
+{
+    va_list args;
+
+    args = (va_list)(rec + 1);
+    RenderFormat(rec->text, args);
+}
+#endif
+
+/*
+ * DrainDeferred
+ * Render every queued record, oldest first, with the level, trace
+ * depth and thread it was queued with.
+ */
+static void DrainDeferred(void)
+{
+    long offset = 0;
+    DeferredRecord *rec;
+    short level = gDebugLevel;
+    short depth = gDebugDepth;
+
+    if (gDebugDraining) return;
+    gDebugDraining = true;
+
+    while (offset < gDebugDeferLen) {
+        rec = (DeferredRecord *)((char *)gDebugDeferQueue + offset);
+        gDebugLevel = rec->level;
+        gDebugDepth = rec->depth;
+        gDebugDrainThread = rec->thread;
+        switch (rec->kind) {
+            case kDeferText:
+                RenderText(rec->text, (const char *)(rec + 1), rec->value);
+                break;
+            case kDeferInt:
+                RenderInt(rec->text, rec->value);
+                break;
+            case kDeferHex:
+                RenderHex(rec->text, (unsigned long)rec->value);
+                break;
+            case kDeferPStr:
+                RenderCPStr(rec->text, (ConstStr255Param)(rec + 1));
+                break;
+#if kDebugCanDeferArgs
+            case kDeferFormat:
+                ReplayFormat(rec);
+                break;
+#endif
+        }
+        offset += rec->size;
+    }
+
+    gDebugLevel = level;
+    gDebugDepth = depth;
+    gDebugDeferLen = 0;
+    gDebugDraining = false;
+}
+
+/*
+ * DebugLog
+ * Write a simple text message to the log.
+ */
+void DebugLog(const char *message)
+{
+    /* Skip the length scan when logging is off */
+    if (!gDebugEnabled) {
+        gDebugStats.dropped++;
+        return;
+    }
+    if (gDebugLevel < gDebugMinLevel) return;
+
+    DebugLogN(message, MyStrLen(message));
+}
+
+/*
+ * LogText
+ * Shared by DebugLogN and DebugLogLiteral. source is the message when
+ * it is known never to change, so coalescing can recognise it, else nil.
+ */
+static void LogText(const char *source, const char *message, long length)
+{
+    DeferredRecord *rec;
+
+    /* Immediate safety checks */
+    if (!gDebugEnabled) {
+        gDebugStats.dropped++;
+        return;
+    }
+
+    if (gDebugLevel < gDebugMinLevel) {
+        return;     /* No sink takes this level */
+    }
+
+    if (message == nil) {
+        gDebugStats.dropped++;
+        return;
+    }
+
+    if (length <= 0) {
+        gDebugStats.dropped++;
+        return;
+    }
+
+    /* Deferred: keep a copy, the caller's buffer may change */
+    rec = DeferAlloc(kDeferText, length);
+    if (rec != nil) {
+        rec->text = source;
+        rec->value = length;
+        MyMemCopy((char *)(rec + 1), message, length);
+        return;
+    }
+
+    /* Assemble and commit the line */
+    RenderText(source, message, length);
+}
+
+/*
+ * DebugLogN
+ * Write a message whose length is already known. The caller's buffer
+ * may be reused with other text, so it is never taken as constant.
+ */
+void DebugLogN(const char *message, long length)
+{
+    LogText(nil, message, length);
+}
+
+/*
+ * DebugLogLiteral
+ * Write text that never changes, such as a string literal.
+ */
+void DebugLogLiteral(const char *literal, long length)
+{
+    LogText(literal, literal, length);
+}
+
+/*
+ * DebugLogPStr
+ * Write a Pascal string straight from its length byte.
+ */
+void DebugLogPStr(ConstStr255Param message)
+{
+    if (message == nil) {
+        DebugLogN(nil, 0);
+        return;
+    }
+    DebugLogN((const char *)&message[1], message[0]);
+}
+
+/*
+ * DebugLogCPStr
+ * Write a C string prefix followed by a Pascal string on one line.
+ */
+void DebugLogCPStr(const char *prefix, ConstStr255Param message)
+{
+    DeferredRecord *rec;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel || message == nil) {
+        return;
+    }
+
+    /* Deferred: Toolbox strings often live in temporary buffers, so copy */
+    rec = DeferAlloc(kDeferPStr, message[0] + 1);
+    if (rec != nil) {
+        rec->text = prefix;
+        MyMemCopy((char *)(rec + 1), (const char *)message, message[0] + 1);
+        return;
+    }
+
+    RenderCPStr(prefix, message);
+}
+
+/*
+ * DebugLogInt
+ * Write a message with an integer value.
+ */
+void DebugLogInt(const char *message, long value)
+{
+    DeferredRecord *rec;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel || message == nil) {
+        return;
+    }
+
+    rec = DeferAlloc(kDeferInt, 0);
+    if (rec != nil) {
+        rec->text = message;
+        rec->value = value;
+        return;
+    }
+
+    RenderInt(message, value);
+}
+
+/*
+ * DebugSetStringTable
+ * Register the message table used by DebugLogID.
+ */
+void DebugSetStringTable(const DebugString *table, short count)
+{
+    gDebugStrings = table;
+    gDebugStringCount = (table != nil) ? count : 0;
+}
+
+/*
+ * DebugLogID
+ * Write a message from the string table, as text or as an ID record.
+ */
+void DebugLogID(short id)
+{
+    char record[3];
+    const DebugString *entry;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel) {
+        return;
+    }
+
+    LineBegin();
+
+    entry = nil;
+    if (id >= 0 && id < gDebugStringCount) {
+        entry = &gDebugStrings[id];
+    }
+
+    if (entry != nil && entry->text != nil && !gDebugConfig.binaryIDs) {
+        /* Length was worked out at compile time */
+        gDebugCur->source = entry->text;
+        gDebugCur->sourceAt = gDebugCur->len;
+        LinePut(entry->text, entry->length);
+    } else if (id >= 0 && id <= kDebugMaxStringID) {
+        /* Marker plus two 7-bit halves; never contains a CR */
+        record[0] = kDebugIDMarker;
+        record[1] = (char)(0x80 | ((id >> 7) & 0x7F));
+        record[2] = (char)(0x80 | (id & 0x7F));
+        LinePut(record, 3);
+    } else {
+        LinePutStr("(bad message ID ");
+        LinePutSigned(id);
+        LinePutStr(")");
+    }
+
+    LineEnd();
+}
+
+/*
+ * DebugLogHex
+ * Write a message with a hex value.
+ */
+void DebugLogHex(const char *message, unsigned long value)
+{
+    DeferredRecord *rec;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel || message == nil) {
+        return;
+    }
+
+    rec = DeferAlloc(kDeferHex, 0);
+    if (rec != nil) {
+        rec->text = message;
+        rec->value = (long)value;
+        return;
+    }
+
+    RenderHex(message, value);
+}
+
+/*
+ * DebugLogFormat
+ * Write a printf-style formatted message.
+ */
+void DebugLogFormat(const char *format, ...)
+{
+    va_list args;
+#if kDebugCanDeferArgs
+    DeferredRecord *rec;
+#endif
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel || format == nil) {
+        return;
+    }
+
+#if kDebugCanDeferArgs
+    /* Deferred: a fixed-size copy of the raw arguments, whatever the format */
+    rec = DeferAlloc(kDeferFormat, kDebugFormatArgBytes);
+    if (rec != nil) {
+        rec->text = format;
+        va_start(args, format);
+        MyMemCopy((char *)(rec + 1), (const char *)args, kDebugFormatArgBytes);
+        va_end(args);
+        return;
+    }
+#endif
+
+    va_start(args, format);
+    RenderFormat(format, args);
+    va_end(args);
+}
+
+/*
+ * DebugFlush
+ * Write any buffered lines and flush the volume.
+ */
+void DebugFlush(void)
+{
+    short i;
+
+    if (!gDebugEnabled) return;
+
+    EnterLogger();
+    DrainDeferred();
+    FlushRepeats();
+    RetryHeld(true);
+    for (i = 0; i < gDebugSinkCount; i++) {
+        if (WriteBuffer(&gDebugSinks[i])) {
+            FlushSink(&gDebugSinks[i]);
+        }
+    }
+    LeaveLogger();
+}
+
+/*
+ * DebugIdle
+ * Honour the kDebugFlushEveryN tick limit between log calls.
+ */
+void DebugIdle(void)
+{
+    DebugSinkState *sink;
+    short i;
+
+    if (!gDebugEnabled) return;
+
+    EnterLogger();
+    DrainDeferred();
+    CheckMetricsDue();
+    CheckCheckpointDue();
+    RetryHeld(false);
+
+    if (gDebugConfig.flushPolicy == kDebugFlushEveryN && gDebugConfig.flushTicks > 0) {
+        for (i = 0; i < gDebugSinkCount; i++) {
+            sink = &gDebugSinks[i];
+            if (sink->bufLines > 0 &&
+                TickCount() - sink->bufTick >= gDebugConfig.flushTicks) {
+                WriteBuffer(sink);
+            }
+        }
+    }
+    LeaveLogger();
+}
+
+/*
+ * DebugClose
+ * Close the debug log file.
+ */
+void DebugClose(void)
+{
+    const char *endMsg = "DEBUG LOG CLOSED";
+    short i;
+
+    /* No snapshots or checkpoints among the closing lines */
+    gDebugConfig.metricsTicks = 0;
+    gDebugCheckTicks = 0;
+
+    if (gDebugSinkCount > 0) {
+        DrainDeferred();
+        DebugTimerReport();
+        if (gDebugConfig.trackMemory) DebugLogMemory();
+        FlushRepeats();
+        if (gDebugConfig.closeStats) DebugLogStats();
+        gDebugDepth = 0;
+        LineBegin();
+        gDebugCur->level = kDebugLevelAll;
+        LinePut(endMsg, MyStrLen(endMsg));
+        LineEnd();
+        WriteAllBuffers();
+        WriteIndex();
+        CloseAllSinks();
+    }
+
+    /* Timers stay registered; the next log starts with fresh figures */
+    for (i = 0; i < gDebugTimerCount; i++) {
+        gDebugTimers[i].count = 0;
+    }
+
+    gDebugEnabled = false;
+}
+
+/*
+ * DebugLogSuppressed
+ * Report how many messages a rate-limited call site skipped.
+ */
+void DebugLogSuppressed(unsigned long count)
+{
+    char numBuf[12];
+    const char *prefix = "(suppressed ";
+    const char *suffix = " messages)";
+
+    gDebugStats.suppressed += count;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel) {
+        return;
+    }
+
+    LineBegin();
+    LinePut(prefix, MyStrLen(prefix));
+    LinePut(numBuf, FormatUnsigned(numBuf, count));
+    LinePut(suffix, MyStrLen(suffix));
+    LineEnd();
+}
+
+/*
+ * DebugSetLevel
+ * Set the level given to lines logged from now on.
+ */
+short DebugSetLevel(short level)
+{
+    short previous = gDebugLevel;
+
+    if (level < kDebugLevelTrace) level = kDebugLevelTrace;
+    if (level > kDebugLevelError) level = kDebugLevelError;
+    gDebugLevel = level;
+    return previous;
+}
+
+/*
+ * DebugLogAt
+ * Write a simple text message at the given level.
+ */
+void DebugLogAt(short level, const char *message)
+{
+    short previous;
+
+    if (!gDebugEnabled || level < gDebugMinLevel) return;
+
+    previous = DebugSetLevel(level);
+    DebugLog(message);
+    gDebugLevel = previous;
+}
+
+/*
+ * DebugAddSerialSink
+ * Send lines at or above a level to a serial port as well.
+ */
+short DebugAddSerialSink(short port, short minLevel)
+{
+    DebugSinkState *sink;
+
+    if (!gDebugEnabled) return -1;
+    if (port != kDebugSinkModem && port != kDebugSinkPrinter) return -1;
+    if (FindSink(port) != nil) return -1;
+
+    sink = AddSink(port, minLevel, kDebugBufSize);
+    if (sink == nil) return -1;
+    if (!OpenSerialPort(sink)) {
+        CloseSink(sink);
+        gDebugSinkCount--;
+        UpdateMinLevel();
+        return -1;
+    }
+    return (short)(sink - gDebugSinks);
+}
+
+/*
+ * DebugAddRingSink
+ * Keep the most recent lines at or above a level in memory.
+ */
+short DebugAddRingSink(long size, short minLevel)
+{
+    DebugSinkState *sink;
+
+    if (!gDebugEnabled || size <= 0) return -1;
+
+    sink = AddSink(kDebugSinkRing, minLevel, size);
+    if (sink == nil) return -1;
+    return (short)(sink - gDebugSinks);
+}
+
+/*
+ * DebugAddCallbackSink
+ * Pass lines at or above a level to a function of the caller's.
+ */
+short DebugAddCallbackSink(DebugSinkProc proc, void *refCon, short minLevel)
+{
+    DebugSinkState *sink;
+
+    if (!gDebugEnabled || proc == nil) return -1;
+
+    sink = AddSink(kDebugSinkCallback, minLevel, 0);
+    if (sink == nil) return -1;
+    sink->proc = proc;
+    sink->refCon = refCon;
+    return (short)(sink - gDebugSinks);
+}
+
+/*
+ * DebugSetSinkLevel
+ * Change the lowest level a sink takes.
+ */
+void DebugSetSinkLevel(short sinkID, short minLevel)
+{
+    if (sinkID < 0 || sinkID >= gDebugSinkCount) return;
+
+    gDebugSinks[sinkID].minLevel = minLevel;
+    UpdateMinLevel();
+}
+
+/*
+ * DebugRingCopy
+ * Copy the newest text in a ring sink, oldest first.
+ */
+long DebugRingCopy(short sinkID, char *dest, long size)
+{
+    DebugSinkState *sink;
+    long total;
+    long start;
+    long first;
+
+    if (sinkID < 0 || sinkID >= gDebugSinkCount || dest == nil) return 0;
+    sink = &gDebugSinks[sinkID];
+    if (sink->kind != kDebugSinkRing) return 0;
+
+    /* The oldest text follows the write position once the ring has wrapped */
+    if (sink->wrapped) {
+        total = sink->bufSize;
+        start = sink->bufLen;
+    } else {
+        total = sink->bufLen;
+        start = 0;
+    }
+
+    /* Keep the newest text if dest is too small */
+    if (total > size) {
+        start += total - size;
+        if (start >= sink->bufSize) start -= sink->bufSize;
+        total = size;
+    }
+
+    first = sink->bufSize - start;
+    if (first > total) first = total;
+    MyMemCopy(dest, sink->buf + start, first);
+    MyMemCopy(dest + first, sink->buf, total - first);
+    return total;
+}
+
+/*
+ * DebugTimerRegister
+ * Find or add a named timer.
+ */
+short DebugTimerRegister(const char *name)
+{
+    short i;
+
+    if (name == nil) return -1;
+
+    for (i = 0; i < gDebugTimerCount; i++) {
+        if (MyStrEqual(gDebugTimers[i].name, name)) return i;
+    }
+
+    if (gDebugTimerCount >= kDebugMaxTimers) return -1;
+
+    gDebugTimers[gDebugTimerCount].name = name;
+    gDebugTimers[gDebugTimerCount].count = 0;
+    return gDebugTimerCount++;
+}
+
+/*
+ * DebugTimerBegin
+ * Read the best clock available, in microseconds.
+ */
+unsigned long DebugTimerBegin(void)
+{
+    UnsignedWide now;
+    long response;
+
+    if (gDebugClock == 0) {
+        if (Gestalt(gestaltTimeMgrVersion, &response) == noErr &&
+            response >= gestaltExtendedTimeMgr) {
+            gDebugClock = 1;
+        } else {
+            gDebugClock = 2;
+        }
+    }
+
+    if (gDebugClock == 1) {
+        Microseconds(&now);
+        return now.lo;
+    }
+    return TickCount() * kDebugUsecPerTick;
+}
+
+/*
+ * DebugTimerEnd
+ * Accumulate one measurement. Memory only; never writes to disk.
+ */
+unsigned long DebugTimerEnd(short timerID, unsigned long start)
+{
+    unsigned long elapsed;
+    unsigned long scaled;
+    short bucket;
+    DebugTimer *timer;
+
+    elapsed = DebugTimerBegin() - start;
+
+    if (timerID < 0 || timerID >= gDebugTimerCount) return elapsed;
+    timer = &gDebugTimers[timerID];
+
+    if (timer->count == 0) {
+        timer->total.hi = 0;
+        timer->total.lo = 0;
+        timer->min = elapsed;
+        timer->max = elapsed;
+        for (bucket = 0; bucket < kDebugTimerBuckets; bucket++) {
+            timer->buckets[bucket] = 0;
+        }
+    }
+    timer->count++;
+    timer->total.lo += elapsed;
+    if (timer->total.lo < elapsed) timer->total.hi++;
+    if (elapsed < timer->min) timer->min = elapsed;
+    if (elapsed > timer->max) timer->max = elapsed;
+
+    /* Bucket n holds times from 2^n up to 2^(n+1) - 1 microseconds */
+    bucket = 0;
+    scaled = elapsed >> 1;
+    while (scaled != 0 && bucket < kDebugTimerBuckets - 1) {
+        scaled >>= 1;
+        bucket++;
+    }
+    timer->buckets[bucket]++;
+
+    return elapsed;
+}
+
+/*
+ * DebugTimerReport
+ * Write one summary line and one histogram line per used timer.
+ */
+void DebugTimerReport(void)
+{
+    char numBuf[24];
+    short i;
+    short b;
+    DebugTimer *timer;
+    UnsignedWide avg;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel) return;
+
+    for (i = 0; i < gDebugTimerCount; i++) {
+        timer = &gDebugTimers[i];
+        if (timer->count == 0) continue;
+
+        LineBegin();
+        LinePutStr("TIMER ");
+        LinePutStr(timer->name);
+        LinePutStr(" n=");
+        LinePutNum(timer->count);
+        LinePutStr(" total=");
+        LinePut(numBuf, FormatWide(numBuf, timer->total));
+        LinePutStr("us min=");
+        LinePutNum(timer->min);
+        LinePutStr(" max=");
+        LinePutNum(timer->max);
+        LinePutStr(" avg=");
+        avg = timer->total;
+        DivideWide(&avg, timer->count);
+        LinePutNum(avg.lo);
+        LineEnd();
+
+        /* Non-empty buckets as "2^n:count" */
+        LineBegin();
+        LinePutStr("  hist");
+        for (b = 0; b < kDebugTimerBuckets; b++) {
+            if (timer->buckets[b] == 0) continue;
+            LinePutStr(" 2^");
+            LinePutNum(b);
+            LinePutStr(":");
+            LinePutNum(timer->buckets[b]);
+        }
+        LineEnd();
+    }
+}
+
+/*
+ * DebugTraceEnter
+ * Log entry to a function and indent the lines that follow.
+ */
+unsigned long DebugTraceEnter(const char *name)
+{
+    if (!gDebugEnabled || kDebugLevelTrace < gDebugMinLevel || name == nil) {
+        gDebugDepth++;
+        return 0;
+    }
+
+    LineBegin();
+    gDebugCur->level = kDebugLevelTrace;
+    LinePutStr(">>> ");
+    LinePutStr(name);
+    LineEnd();
+
+    gDebugDepth++;
+    return DebugTimerBegin();
+}
+
+/*
+ * DebugTraceExit
+ * Undo the indentation and log exit with the elapsed time.
+ */
+void DebugTraceExit(const char *name, unsigned long start)
+{
+    unsigned long elapsed;
+
+    if (gDebugDepth > 0) gDebugDepth--;
+
+    if (!gDebugEnabled || kDebugLevelTrace < gDebugMinLevel || name == nil) {
+        return;
+    }
+
+    elapsed = DebugTimerBegin() - start;
+
+    LineBegin();
+    gDebugCur->level = kDebugLevelTrace;
+    LinePutStr("<<< ");
+    LinePutStr(name);
+    LinePutStr(" ");
+    LinePutNum(elapsed);
+    LinePutStr("us");
+    LineEnd();
+}
+
+/*
+ * DebugMetricRegister
+ * Find or add a named counter or gauge.
+ */
+short DebugMetricRegister(const char *name, short kind)
+{
+    short i;
+
+    if (name == nil) return kDebugMaxMetrics;
+
+    for (i = 0; i < gDebugMetricCount; i++) {
+        if (MyStrEqual(gDebugMetricNames[i], name)) return i;
+    }
+
+    if (gDebugMetricCount >= kDebugMaxMetrics) return kDebugMaxMetrics;
+
+    gDebugMetricNames[gDebugMetricCount] = name;
+    gDebugMetricKinds[gDebugMetricCount] = kind;
+    gDebugMetrics[gDebugMetricCount] = 0;
+    gDebugMetricPrev[gDebugMetricCount] = 0;
+    return gDebugMetricCount++;
+}
+
+/*
+ * DebugMetricsSnapshot
+ * Write every metric on one line. Counters show the total and the
+ * change since the previous snapshot.
+ */
+void DebugMetricsSnapshot(void)
+{
+    short i;
+    long value;
+    long delta;
+
+    /* Stamp first: LineEnd checks whether a snapshot is due */
+    gDebugMetricsTick = TickCount();
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel || gDebugMetricCount == 0) return;
+
+    LineBegin();
+    LinePutStr("METRICS");
+    for (i = 0; i < gDebugMetricCount; i++) {
+        value = gDebugMetrics[i];
+        LinePutStr(" ");
+        LinePutStr(gDebugMetricNames[i]);
+        LinePutStr("=");
+        LinePutSigned(value);
+        if (gDebugMetricKinds[i] == kDebugCounter) {
+            delta = value - gDebugMetricPrev[i];
+            gDebugMetricPrev[i] = value;
+            LinePutStr(delta < 0 ? "" : "+");
+            LinePutSigned(delta);
+        }
+    }
+    LineEnd();
+}
+
+/*
+ * DebugLogMemory
+ * Write heap and stack figures for the current zone on one line.
+ */
+void DebugLogMemory(void)
+{
+    long freeBytes;
+    long maxBlock;
+    long purgeTotal;
+    long purgeContig;
+    long stack;
+
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel) return;
+
+    freeBytes = FreeMem();
+    maxBlock = MaxBlock();
+    PurgeSpace(&purgeTotal, &purgeContig);
+    stack = StackSpace();
+
+    if (freeBytes < gDebugLowFree) gDebugLowFree = freeBytes;
+    if (stack < gDebugLowStack) gDebugLowStack = stack;
+
+    LineBegin();
+    LinePutStr("MEMORY free=");
+    LinePutSigned(freeBytes);
+    LinePutStr(" maxBlock=");
+    LinePutSigned(maxBlock);
+    LinePutStr(" purgeable=");
+    LinePutSigned(purgeTotal - freeBytes);
+    LinePutStr(" stack=");
+    LinePutSigned(stack);
+    if (gDebugConfig.trackMemory) {
+        LinePutStr(" lowFree=");
+        LinePutSigned(gDebugLowFree);
+        LinePutStr(" lowStack=");
+        LinePutSigned(gDebugLowStack);
+    }
+    LineEnd();
+}
+
+/*
+ * DebugGetStats
+ * Copy the logger's own figures.
+ */
+void DebugGetStats(DebugStats *stats)
+{
+    if (stats != nil) *stats = gDebugStats;
+}
+
+/*
+ * DebugLogStats
+ * Write the DebugGetStats figures on one line.
+ */
+void DebugLogStats(void)
+{
+    if (!gDebugEnabled || gDebugLevel < gDebugMinLevel) return;
+
+    LineBegin();
+    LinePutStr("STATS lines=");
+    LinePutNum(gDebugStats.lines);
+    LinePutStr(" bytes=");
+    LinePutNum(gDebugStats.bytes);
+    LinePutStr(" calls=");
+    LinePutNum(gDebugStats.fileCalls);
+    LinePutStr(" errors=");
+    LinePutNum(gDebugStats.errors);
+    if (gDebugStats.errors != 0) {
+        LinePutStr(" lastError=");
+        LinePutSigned(gDebugStats.lastError);
+    }
+    LinePutStr(" dropped=");
+    LinePutNum(gDebugStats.dropped);
+    LinePutStr(" held=");
+    LinePutNum(gDebugStats.held);
+    LinePutStr(" suppressed=");
+    LinePutNum(gDebugStats.suppressed);
+    LinePutStr(" highWater=");
+    LinePutSigned(gDebugStats.bufHighWater);
+    if (gDebugConfig.timeSelf) {
+        LinePutStr(" inside=");
+        LinePutNum(gDebugStats.usecInside);
+        LinePutStr("us");
+    }
+    LineEnd();
 }
 
 /*
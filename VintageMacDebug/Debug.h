@@ -18,6 +18,169 @@
 #include <Types.h>
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Flush policies
+ * Select how eagerly buffered log text is written to disk.
+ *
+ * kDebugFlushEveryLine: write and FlushVol after every line. Slowest,
+ *                       but the last line survives a crash.
+ * kDebugFlushEveryN:    write once flushLines lines, flushBytes bytes or
+ *                       flushTicks ticks have built up, whichever is first.
+ * kDebugFlushOnClose:   write only when the buffer fills, on DebugFlush
+ *                       and on DebugClose. Fastest, but a crash loses
+ *                       whatever is still buffered.
+ */
+enum {
+    kDebugFlushEveryLine = 0,
+    kDebugFlushEveryN = 1,
+    kDebugFlushOnClose = 2
+};
+
+/*
+ * Open modes
+ * How DebugInitEx gets an empty log file.
+ *
+ * kDebugOpenReplace:  delete the old file and create a new one.
+ * kDebugOpenTruncate: open the existing file and set its length to 0.
+ * kDebugOpenReuse:    open the existing file and write over it from the
+ *                     start, keeping its disk space; DebugClose trims
+ *                     the leftover tail. After a crash, old text may
+ *                     follow the last new line.
+ * kDebugOpenAppend:   keep the existing text and add to the end, after
+ *                     a "=== SESSION" header. A launch counter is kept
+ *                     in the file's first line. With maxFileSize set,
+ *                     a full log is renamed to "<name>.old" and a new
+ *                     one started.
+ * The modes other than Replace create the file only when it doesn't
+ * exist.
+ */
+enum {
+    kDebugOpenReplace = 0,
+    kDebugOpenTruncate = 1,
+    kDebugOpenReuse = 2,
+    kDebugOpenAppend = 3
+};
+
+/*
+ * Sinks
+ * Where the log goes. Each line is formatted once and passed to every
+ * sink whose minimum level it reaches.
+ *
+ * kDebugSinkFile:     the named file.
+ * kDebugSinkModem:    the modem port (.AOut), for capture on another
+ *                     machine. Writes are asynchronous, so logging
+ *                     never waits for the disk.
+ * kDebugSinkPrinter:  the printer port (.BOut), likewise.
+ * kDebugSinkRing:     a block of memory holding the newest text.
+ * kDebugSinkCallback: a function of your own.
+ * DebugInitEx opens a file or serial sink; the serial sinks ignore the
+ * filename, openMode and the file options. Add others with the
+ * DebugAdd...Sink calls.
+ */
+enum {
+    kDebugSinkFile = 0,
+    kDebugSinkModem = 1,
+    kDebugSinkPrinter = 2,
+    kDebugSinkRing = 3,
+    kDebugSinkCallback = 4
+};
+
+#define kDebugMaxSinks 4
+
+/*
+ * Levels
+ * Every line has a level, kDebugLevelInfo unless set otherwise with
+ * DebugSetLevel, DebugLogAt or DEBUG_AT. Trace lines from
+ * DebugTraceEnter/Exit are kDebugLevelTrace. Calls below the lowest
+ * level any sink takes return before formatting anything.
+ */
+enum {
+    kDebugLevelTrace = 0,
+    kDebugLevelInfo = 1,
+    kDebugLevelWarn = 2,
+    kDebugLevelError = 3
+};
+
+/*
+ * DebugSinkProc
+ * Receives text for a callback sink: whole lines ending in a CR, or
+ * pieces of lines longer than 255 characters. Must not call the
+ * Debug functions.
+ */
+typedef void (*DebugSinkProc)(const char *text, long length, void *refCon);
+
+/* Metric kinds for DebugMetricRegister */
+enum {
+    kDebugCounter = 0,          /* Counts events; snapshot shows total and change */
+    kDebugGauge = 1             /* Holds a current value, e.g. queue length */
+};
+
+#define kDebugMaxMetrics 32
+
+/*
+ * DebugString
+ * One entry of the message table generated by Tools/debugstrings.sh.
+ * The length is computed by the compiler, so no strlen is needed.
+ */
+typedef struct DebugString {
+    short length;
+    const char *text;           /* nil in builds made with DEBUG_BINARY_ONLY */
+} DebugString;
+
+/* ID records written by DebugLogID in binaryIDs mode */
+#define kDebugIDMarker      0x01    /* Followed by 0x80|id>>7, 0x80|id&0x7F */
+#define kDebugMaxStringID   0x3FFF
+
+/*
+ * DebugStats
+ * The logger's own figures since DebugInitEx, from DebugGetStats.
+ */
+typedef struct DebugStats {
+    unsigned long lines;        /* Lines completed */
+    unsigned long bytes;        /* Bytes written to the file and serial ports */
+    unsigned long fileCalls;    /* File Manager and serial driver calls */
+    unsigned long errors;       /* Failed File Manager or driver calls */
+    OSErr lastError;            /* Result of the latest failed call */
+    unsigned long dropped;      /* Calls ignored or lines lost */
+    unsigned long held;         /* Lines kept in memory while the file failed */
+    unsigned long suppressed;   /* Lines skipped by coalescing and DEBUG_EVERY_N etc. */
+    long bufHighWater;          /* Most bytes waiting in an output buffer */
+    unsigned long usecInside;   /* Microseconds spent in the logger, with timeSelf */
+} DebugStats;
+
+/*
+ * DebugConfig
+ * Options for DebugInitEx. Fill it in with DebugDefaultConfig first,
+ * then change only the fields you care about.
+ */
+typedef struct DebugConfig {
+    short flushPolicy;          /* kDebugFlushEveryLine etc. */
+    long flushLines;            /* EveryN: lines per write, 0 = no limit */
+    long flushBytes;            /* EveryN: bytes per write, 0 = no limit */
+    unsigned long flushTicks;   /* EveryN: oldest line age, 0 = no limit */
+    Boolean coalesce;           /* Replace runs of identical lines with a count */
+    unsigned long metricsTicks; /* Metrics snapshot interval, 0 = on demand only */
+    Boolean trackMemory;        /* Sample free heap and stack at every line */
+    Boolean binaryIDs;          /* DebugLogID writes ID records, not text */
+    Boolean deferFormat;        /* Queue calls now, render them when flushing */
+    short openMode;             /* kDebugOpenReplace etc. */
+    long preallocate;           /* kDebugOpenReuse: bytes to reserve for a new file */
+    long maxFileSize;           /* kDebugOpenAppend: rotate beyond this, 0 = no cap */
+    short sink;                 /* kDebugSinkFile etc. */
+    short serialConfig;         /* Serial sinks: SerReset settings (baud57600 + data8 ...) */
+    short minLevel;             /* Lowest level the sink above takes */
+    Boolean timeSelf;           /* Add up the time spent in the logger */
+    Boolean closeStats;         /* DebugClose writes a DebugLogStats line */
+    Boolean compress;           /* File sink: write packed blocks (not with kDebugOpenAppend) */
+    Boolean threadTags;         /* Start each line with the ID of the thread that logged it */
+    Boolean sequence;           /* Start each line with a hex sequence number */
+    unsigned long checkpointTicks; /* File sink: checkpoint interval, 0 = none */
+} DebugConfig;
+
 /*
  * DebugInit
  * Initialize the debug log file. Creates/overwrites the file.
@@ -28,6 +191,25 @@
  */
 Boolean DebugInit(const char *filename);
 
+/*
+ * DebugDefaultConfig
+ * Fill a DebugConfig with the settings DebugInit uses
+ * (kDebugFlushEveryLine).
+ *
+ * config: Structure to fill in
+ */
+void DebugDefaultConfig(DebugConfig *config);
+
+/*
+ * DebugInitEx
+ * Initialize the debug log file with explicit options.
+ *
+ * filename: Name of log file
+ * config: Options, or nil for the DebugInit defaults
+ * Returns: true if successful, false if file couldn't be created
+ */
+Boolean DebugInitEx(const char *filename, const DebugConfig *config);
+
 /*
  * DebugLog
  * Write a simple text message to the log file.
@@ -37,6 +219,46 @@ Boolean DebugInit(const char *filename);
  */
 void DebugLog(const char *message);
 
+/*
+ * DebugLogN
+ * Write a message whose length is already known, skipping the
+ * length scan DebugLog does. The text need not be nul-terminated.
+ * For string literals use DEBUG_LOG, which supplies the length.
+ *
+ * message: Text to write to log
+ * length: Number of bytes to write
+ */
+void DebugLogN(const char *message, long length);
+
+/*
+ * DebugLogLiteral
+ * As DebugLogN, for text that never changes while the program runs.
+ * With coalesce, a repeat of it is recognised without hashing. Used
+ * by DEBUG_LOG; never pass a buffer that is reused.
+ *
+ * literal: Constant text, e.g. a string literal
+ * length: Number of bytes to write
+ */
+void DebugLogLiteral(const char *literal, long length);
+
+/*
+ * DebugLogPStr
+ * Write a Pascal string (Str255, Str63, ...) directly from its
+ * length byte, without converting it to a C string first.
+ *
+ * message: Pascal string, e.g. a file or menu item name
+ */
+void DebugLogPStr(ConstStr255Param message);
+
+/*
+ * DebugLogCPStr
+ * Write a C string prefix followed by a Pascal string on one line.
+ *
+ * prefix: Text prefix (e.g., "Opening: "), or nil
+ * message: Pascal string
+ */
+void DebugLogCPStr(const char *prefix, ConstStr255Param message);
+
 /*
  * DebugLogInt
  * Write a message with an integer value.
@@ -46,6 +268,27 @@ void DebugLog(const char *message);
  */
 void DebugLogInt(const char *message, long value);
 
+/*
+ * DebugSetStringTable
+ * Register the message table for DebugLogID. Normally called once
+ * at startup as DebugSetStringTable(gDebugStrings, kDebugStringCount)
+ * after including the generated DebugStrings.h.
+ *
+ * table: Generated table, or nil to remove it
+ * count: Number of entries
+ */
+void DebugSetStringTable(const DebugString *table, short count);
+
+/*
+ * DebugLogID
+ * Write a message by its table ID. Writes the text in text mode, or
+ * a three-byte ID record when binaryIDs is set (decode on the host
+ * with debugstrings.sh -d). Use through DEBUG_MSG.
+ *
+ * id: Message ID from DebugStrings.h
+ */
+void DebugLogID(short id);
+
 /*
  * DebugLogHex
  * Write a message with a hex value.
@@ -58,7 +301,8 @@ void DebugLogHex(const char *message, unsigned long value);
 /*
  * DebugLogFormat
  * Write a formatted message (like printf).
- * Automatically adds newline.
+ * Automatically adds newline. Supports %d %i %u %x %X %c %s %%
+ * with '-', '0', a width and the 'l' (long) modifier.
  * 
  * format: printf-style format string
  * ...: Variable arguments
@@ -67,11 +311,20 @@ void DebugLogFormat(const char *format, ...);
 
 /*
  * DebugFlush
- * Force all buffered log data to be written to disk.
+ * Force all buffered log data to be written to disk and flush
+ * the volume, whatever the flush policy.
  * Useful before potential crashes or at critical points.
  */
 void DebugFlush(void);
 
+/*
+ * DebugIdle
+ * Give the logger a chance to do time-based work, such as the
+ * kDebugFlushEveryN tick limit when no new lines are arriving.
+ * Call it from your event loop (e.g. on null events).
+ */
+void DebugIdle(void);
+
 /*
  * DebugClose
  * Close the debug log file.
@@ -79,6 +332,188 @@ void DebugFlush(void);
  */
 void DebugClose(void);
 
+/*
+ * DebugLogSuppressed
+ * Write a "(suppressed N messages)" line. Used by DEBUG_EVERY_N and
+ * DEBUG_RATE_LIMIT when a limited call site starts logging again.
+ *
+ * count: Number of messages that were skipped
+ */
+void DebugLogSuppressed(unsigned long count);
+
+/*
+ * DebugSetLevel
+ * Set the level of the lines logged from now on.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError
+ * Returns: The previous level
+ */
+short DebugSetLevel(short level);
+
+/*
+ * DebugLogAt
+ * Write a simple text message at the given level.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError
+ * message: Text to write
+ */
+void DebugLogAt(short level, const char *message);
+
+/*
+ * DebugAddSerialSink
+ * Also send lines to a serial port. Call after DebugInitEx; the port
+ * is set up with the config's serialConfig and closed by DebugClose.
+ *
+ * port: kDebugSinkModem or kDebugSinkPrinter
+ * minLevel: Lowest level to send
+ * Returns: Sink number, or -1 if it couldn't be added
+ */
+short DebugAddSerialSink(short port, short minLevel);
+
+/*
+ * DebugAddRingSink
+ * Also keep the newest text in memory, overwriting the oldest. Read it
+ * with DebugRingCopy; it is released by DebugClose.
+ *
+ * size: Bytes of memory to use
+ * minLevel: Lowest level to keep
+ * Returns: Sink number, or -1 if it couldn't be added
+ */
+short DebugAddRingSink(long size, short minLevel);
+
+/*
+ * DebugAddCallbackSink
+ * Also pass lines to a function of your own.
+ *
+ * proc: Function to call
+ * refCon: Passed to proc unchanged
+ * minLevel: Lowest level to pass on
+ * Returns: Sink number, or -1 if it couldn't be added
+ */
+short DebugAddCallbackSink(DebugSinkProc proc, void *refCon, short minLevel);
+
+/*
+ * DebugSetSinkLevel
+ * Change the lowest level a sink takes. Sink 0 is the one opened by
+ * DebugInitEx.
+ *
+ * sinkID: Sink number
+ * minLevel: New lowest level
+ */
+void DebugSetSinkLevel(short sinkID, short minLevel);
+
+/*
+ * DebugRingCopy
+ * Copy the text held by a ring sink, oldest first. If dest is too
+ * small, the newest text is copied.
+ *
+ * sinkID: Sink number from DebugAddRingSink
+ * dest: Where to copy the text
+ * size: Size of dest
+ * Returns: Bytes copied
+ */
+long DebugRingCopy(short sinkID, char *dest, long size);
+
+/*
+ * DebugTimerRegister
+ * Add a named timer to the timing table, or find the existing one
+ * with the same name. The table holds kDebugMaxTimers timers.
+ *
+ * name: Timer name; must stay valid (normally a string literal)
+ * Returns: Timer ID, or -1 if the table is full
+ */
+short DebugTimerRegister(const char *name);
+
+/*
+ * DebugTimerBegin
+ * Read the clock at the start of a timed section. Uses Microseconds
+ * when the extended Time Manager is present, TickCount otherwise.
+ *
+ * Returns: Start time in microseconds, for DebugTimerEnd
+ */
+unsigned long DebugTimerBegin(void);
+
+/*
+ * DebugTimerEnd
+ * Add the time since DebugTimerBegin to a timer's statistics.
+ * Nothing is written to the log.
+ *
+ * timerID: ID from DebugTimerRegister (-1 is ignored)
+ * start: Value returned by DebugTimerBegin
+ * Returns: Elapsed microseconds
+ */
+unsigned long DebugTimerEnd(short timerID, unsigned long start);
+
+/*
+ * DebugTimerReport
+ * Write count, total, min, max, average and histogram for every
+ * timer that has been used. Called automatically by DebugClose.
+ */
+void DebugTimerReport(void);
+
+/*
+ * DebugTraceEnter
+ * Write ">>> name" and indent every following line by one more
+ * level (two spaces) until the matching DebugTraceExit.
+ *
+ * name: Function or section name
+ * Returns: Start time, for DebugTraceExit
+ */
+unsigned long DebugTraceEnter(const char *name);
+
+/*
+ * DebugTraceExit
+ * Remove one level of indentation and write "<<< name 123us".
+ *
+ * name: Same name as passed to DebugTraceEnter
+ * start: Value returned by DebugTraceEnter
+ */
+void DebugTraceExit(const char *name, unsigned long start);
+
+/*
+ * DebugMetricRegister
+ * Add a named counter or gauge, or find the existing one with the
+ * same name. Register once (e.g. at startup) and keep the ID.
+ *
+ * name: Metric name; must stay valid (normally a string literal)
+ * kind: kDebugCounter or kDebugGauge
+ * Returns: Metric ID. If the table is full, a spare slot that is
+ *          never reported, so the macros below stay safe to use.
+ */
+short DebugMetricRegister(const char *name, short kind);
+
+/*
+ * DebugMetricsSnapshot
+ * Write all metrics as a single "METRICS name=value ..." line.
+ * Also written automatically every metricsTicks ticks (see DebugConfig).
+ */
+void DebugMetricsSnapshot(void);
+
+/*
+ * DebugLogMemory
+ * Write free heap, largest free block, purgeable space and stack
+ * headroom for the current zone as one "MEMORY ..." line. With
+ * trackMemory set, the lowest free heap and stack seen are added,
+ * and the line is also written by DebugClose.
+ */
+void DebugLogMemory(void);
+
+/*
+ * DebugGetStats
+ * Read what the logger has done and what it has cost since
+ * DebugInitEx. Failures are counted here rather than signalled.
+ *
+ * stats: Structure to fill in
+ */
+void DebugGetStats(DebugStats *stats);
+
+/*
+ * DebugLogStats
+ * Write the DebugGetStats figures as one "STATS ..." line. With
+ * closeStats set, the line is also written by DebugClose.
+ */
+void DebugLogStats(void);
+
 /*
  * DebugIsEnabled
  * Check if debug logging is currently enabled.
@@ -86,4 +521,162 @@ void DebugClose(void);
  */
 Boolean DebugIsEnabled(void);
 
+/*
+ * DEBUG_LOG
+ * Log a string literal with its length worked out by the compiler.
+ * Only accepts literals; use DebugLog for other strings.
+ *
+ * literal: Message text, e.g. "Entering event loop"
+ */
+#define DEBUG_LOG(literal)  DebugLogLiteral("" literal, sizeof(literal) - 1)
+
+/*
+ * DEBUG_MSG
+ * Log a message from the generated string table. The literal is only
+ * there for Tools/debugstrings.sh and for readers; the preprocessor
+ * drops it, so it takes no space in the code segment.
+ *
+ * id: Message ID, e.g. kDbgAppStarted
+ * literal: Message text, e.g. "Application started"
+ */
+#define DEBUG_MSG(id, literal)  DebugLogID(id)
+
+/*
+ * DebugTicks
+ * Current tick count read straight from the Ticks low-memory global,
+ * so the limiters below don't pay for a TickCount trap.
+ */
+#define DebugTicks() (*(volatile unsigned long *)0x016A)
+
+/*
+ * DEBUG_AT
+ * Run a logging statement at the given level, then restore the
+ * previous level.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError
+ * statement: Logging call, e.g. DebugLogInt("Bad count: ", n)
+ */
+#define DEBUG_AT(level, statement) \
+    do { \
+        short dbgLevel_ = DebugSetLevel(level); \
+        statement; \
+        DebugSetLevel(dbgLevel_); \
+    } while (0)
+
+/*
+ * DEBUG_EVERY_N
+ * Run a logging statement on the first call and then once every n
+ * calls from this call site. Skipped calls cost a compare and two
+ * adds and never enter Debug.c.
+ *
+ * n: Calls per logged call (1 or more)
+ * statement: Logging call, e.g. DebugLogInt("Item: ", i)
+ */
+#define DEBUG_EVERY_N(n, statement) \
+    do { \
+        static unsigned long dbgLeft_ = 0; \
+        static unsigned long dbgSkipped_ = 0; \
+        if (dbgLeft_ != 0) { \
+            dbgLeft_--; \
+            dbgSkipped_++; \
+        } else { \
+            dbgLeft_ = (n) - 1; \
+            if (dbgSkipped_ != 0) DebugLogSuppressed(dbgSkipped_); \
+            dbgSkipped_ = 0; \
+            statement; \
+        } \
+    } while (0)
+
+/*
+ * DEBUG_RATE_LIMIT
+ * Run a logging statement at most k times per second from this call
+ * site. Skipped calls read Ticks, compare and count, and never enter
+ * Debug.c.
+ *
+ * k: Logged calls allowed per second
+ * statement: Logging call, e.g. DebugLog("Null event")
+ */
+#define DEBUG_RATE_LIMIT(k, statement) \
+    do { \
+        static unsigned long dbgWindow_ = 0; \
+        static unsigned long dbgSent_ = 0; \
+        static unsigned long dbgSkipped_ = 0; \
+        if (DebugTicks() - dbgWindow_ >= 60) { \
+            dbgWindow_ = DebugTicks(); \
+            dbgSent_ = 0; \
+        } \
+        if (dbgSent_ < (unsigned long)(k)) { \
+            dbgSent_++; \
+            if (dbgSkipped_ != 0) DebugLogSuppressed(dbgSkipped_); \
+            dbgSkipped_ = 0; \
+            statement; \
+        } else { \
+            dbgSkipped_++; \
+        } \
+    } while (0)
+
+/*
+ * DEBUG_TIMER_SCOPE_BEGIN / DEBUG_TIMER_SCOPE_END
+ * Time the statements between the pair. The timer is registered on
+ * first use and its ID kept in a static, so later passes only read
+ * the clock twice. A return or goto out of the scope skips the
+ * measurement.
+ *
+ * name: Timer name (string literal)
+ */
+#define DEBUG_TIMER_SCOPE_BEGIN(name) \
+    { \
+        static short dbgTimerID_ = -2; \
+        unsigned long dbgTimerStart_; \
+        if (dbgTimerID_ == -2) dbgTimerID_ = DebugTimerRegister(name); \
+        dbgTimerStart_ = DebugTimerBegin();
+
+#define DEBUG_TIMER_SCOPE_END() \
+        DebugTimerEnd(dbgTimerID_, dbgTimerStart_); \
+    }
+
+/*
+ * DEBUG_TRACE_ENTER / DEBUG_TRACE_EXIT
+ * Trace a function. DEBUG_TRACE_ENTER declares a variable, so put it
+ * after the function's local declarations. Every way out of the
+ * function needs a DEBUG_TRACE_EXIT, or later lines stay indented.
+ *
+ * name: Function name (string literal)
+ */
+#define DEBUG_TRACE_ENTER(name) \
+    unsigned long dbgTraceStart_ = DebugTraceEnter(name)
+
+#define DEBUG_TRACE_EXIT(name) \
+    DebugTraceExit(name, dbgTraceStart_)
+
+/*
+ * Metric updates
+ * Each is a single add or store to a static slot; nothing is written
+ * until the next snapshot.
+ *
+ * id: ID from DebugMetricRegister
+ */
+extern long gDebugMetrics[kDebugMaxMetrics + 1];
+
+#define DEBUG_COUNT(id)             (gDebugMetrics[id]++)
+#define DEBUG_COUNT_ADD(id, n)      (gDebugMetrics[id] += (n))
+#define DEBUG_GAUGE_SET(id, value)  (gDebugMetrics[id] = (value))
+
+/*
+ * DEBUG_WANTS
+ * Check, without a call into Debug.c, whether any sink takes lines at
+ * a level. False whenever no log is open. Lets callers skip building
+ * a line nobody will see.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError, or gDebugLevel
+ */
+extern short gDebugLevel;       /* Level given to new lines; set with DebugSetLevel */
+extern short gDebugMinLevel;    /* Lowest level any sink takes */
+
+#define DEBUG_WANTS(level)  ((level) >= gDebugMinLevel)
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* DEBUG_H */
@@ -0,0 +1,819 @@
+/*
+ * Debug.hpp
+ * Type-safe C++ front end for Debug.c
+ *
+ * Usage:
+ *   DEBUG_LINE("Window ", windowID, " moved to ", where.h, ",", where.v);
+ *   DEBUG_LINE_AT(kDebugLevelWarn, "Retries: ", retries);
+ *   DEBUG_LINE("Handle: ", Debug::Hex(handle), " type ", Debug::Type('TEXT'));
+ *   DEBUG_FORMAT("Tile %d at (%d,%d) conn=%02X", index, row, col, conn);
+ *   DEBUG_SCOPE("DrawWindow");
+ *
+ * Each argument is turned into text by a renderer picked for its type
+ * at compile time, the whole line is built in a buffer on the stack,
+ * and Debug.c is called once per line. Nothing is built when no sink
+ * takes the line's level. With DEBUG_ENABLED set to 0 the macros
+ * expand to nothing, so their arguments aren't even evaluated.
+ *
+ * DEBUG_FORMAT takes a DebugLogFormat-style format, parsed while
+ * compiling: a bad conversion or an argument of the wrong type is a
+ * compile error, and each call site gets its own renderer with no
+ * format left to scan at run time.
+ *
+ * DEBUG_SCOPE traces entry to and exit from the rest of a scope, with
+ * the time inside, however the scope is left, and feeds the same
+ * timer statistics as DebugTimerEnd for DebugTimerReport.
+ *
+ * Needs a C++11 compiler (Retro68, for example); DEBUG_FORMAT needs
+ * C++17. THINK C projects keep using Debug.h; both can be used in the
+ * same programme.
+ *
+ * Copyright © 2026 Pascal Harris. All rights reserved.
+ */
+
+#ifndef DEBUG_HPP
+#define DEBUG_HPP
+
+#include "Debug.h"
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#endif
+
+#ifndef DEBUG_ENABLED
+#define DEBUG_ENABLED 1
+#endif
+
+namespace Debug {
+
+/*
+ * HexValue / Hex
+ * Show an integer in hex, as many digits as its type holds:
+ * Hex((unsigned char)7) gives 0x07, Hex(0x1234L) gives 0x00001234.
+ * A pointer or Handle is shown as an 8-digit address.
+ */
+template <typename T>
+struct HexValue {
+    T value;
+};
+
+template <typename T>
+inline HexValue<T> Hex(T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_pointer<T>::value,
+                  "Debug::Hex takes an integer or a pointer");
+    static_assert(!std::is_integral<T>::value || sizeof(T) <= sizeof(unsigned long),
+                  "Debug::Hex takes integers no wider than unsigned long");
+    return HexValue<T>{value};
+}
+
+/*
+ * TypeValue / Type
+ * Show a four-character code, such as an OSType or ResType, as 'TEXT'.
+ */
+struct TypeValue {
+    unsigned long value;
+};
+
+inline TypeValue Type(unsigned long code)
+{
+    return TypeValue{code};
+}
+
+/*
+ * LineBuffer
+ * Stack buffer a line is built in. Text past kLineMax characters is
+ * dropped; one byte is kept for the terminating NUL.
+ */
+class LineBuffer {
+public:
+    enum { kLineMax = 255 };
+
+    LineBuffer() : len_(0) {}
+
+    void Put(char c)
+    {
+        if (len_ < kLineMax) text_[len_++] = c;
+    }
+
+    void Put(const char *text, short len)
+    {
+        if (len > kLineMax - len_) len = kLineMax - len_;
+        while (len-- > 0) text_[len_++] = *text++;
+    }
+
+    void Pad(char c, short count)
+    {
+        while (count-- > 0 && len_ < kLineMax) text_[len_++] = c;
+    }
+
+    /* Insert count copies of c at from; text pushed past the end is dropped */
+    void Insert(short from, char c, short count)
+    {
+        short end;
+        short i;
+
+        if (count > kLineMax - from) count = kLineMax - from;
+        end = len_ + count;
+        if (end > kLineMax) end = kLineMax;
+        for (i = end - 1; i >= from + count; i--) text_[i] = text_[i - count];
+        for (i = from; i < from + count; i++) text_[i] = c;
+        len_ = end;
+    }
+
+    /* NUL-terminated: copied and measured in one pass */
+    void PutString(const char *text)
+    {
+        while (*text != '\0' && len_ < kLineMax) text_[len_++] = *text++;
+    }
+
+    const char *Text()
+    {
+        text_[len_] = '\0';
+        return text_;
+    }
+
+    short Length() const { return len_; }
+
+private:
+    char text_[kLineMax + 1];
+    short len_;
+};
+
+namespace Detail {
+
+/* Pairs "00" to "99", as in Debug.c */
+inline const char *DigitPairs()
+{
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324"
+        "25262728293031323334353637383940414243444546474849"
+        "50515253545556575859606162636465666768697071727374"
+        "75767778798081828384858687888990919293949596979899";
+    return pairs;
+}
+
+/*
+ * PutUnsigned
+ * Decimal text for a 32-bit value. Same method as FormatUnsigned in
+ * Debug.c: subtraction for the upper digits and one 16-bit divide for
+ * the lower four, avoiding 32-bit divides on the 68000. Keep the two
+ * in step.
+ */
+inline void PutUnsigned(LineBuffer &line, unsigned long value)
+{
+    static const unsigned long powers[] = {
+        1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL
+    };
+    const char *pairs = DigitPairs();
+    unsigned short low;
+    unsigned short high;
+    short i;
+    char digit;
+
+    if (value >= 10000UL) {
+        i = 0;
+        while (value < powers[i]) i++;
+        for (; i < 6; i++) {
+            digit = '0';
+            while (value >= powers[i]) {
+                value -= powers[i];
+                digit++;
+            }
+            line.Put(digit);
+        }
+        low = (unsigned short)value;
+        high = low / 100;
+        low -= high * 100;
+        line.Put(&pairs[high * 2], 2);
+        line.Put(&pairs[low * 2], 2);
+        return;
+    }
+
+    low = (unsigned short)value;
+    high = low / 100;
+    low -= high * 100;
+    if (high != 0) {
+        if (high >= 10) line.Put(pairs[high * 2]);
+        line.Put(pairs[high * 2 + 1]);
+        line.Put(&pairs[low * 2], 2);
+    } else {
+        if (low >= 10) line.Put(pairs[low * 2]);
+        line.Put(pairs[low * 2 + 1]);
+    }
+}
+
+inline void PutSigned(LineBuffer &line, long value)
+{
+    if (value < 0) {
+        line.Put('-');
+        PutUnsigned(line, 0UL - (unsigned long)value);
+    } else {
+        PutUnsigned(line, (unsigned long)value);
+    }
+}
+
+inline void PutHex(LineBuffer &line, unsigned long value, short digits)
+{
+    static const char hexChars[] = "0123456789ABCDEF";
+
+    line.Put("0x", 2);
+    while (digits-- > 0) {
+        line.Put(hexChars[(value >> (digits * 4)) & 0x0F]);
+    }
+}
+
+/* Hex without prefix or leading zeros, as FormatHex in Debug.c */
+inline void PutHexDigits(LineBuffer &line, unsigned long value, bool upper)
+{
+    const char *hexChars = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    short digits = 1;
+
+    while (digits < (short)(sizeof(value) * 2) && (value >> (digits * 4)) != 0) digits++;
+    while (digits-- > 0) {
+        line.Put(hexChars[(value >> (digits * 4)) & 0x0F]);
+    }
+}
+
+} /* namespace Detail */
+
+/*
+ * Render
+ * One overload per kind of argument; the compiler picks the renderer,
+ * so nothing is looked up at run time. Add an overload for your own
+ * types in namespace Debug to make them loggable.
+ */
+inline void Render(LineBuffer &line, const char *text)
+{
+    if (text == nullptr) text = "(nil)";
+    line.PutString(text);
+}
+
+/* Pascal string (Str255, StringPtr, ConstStr255Param) */
+inline void Render(LineBuffer &line, const unsigned char *pstr)
+{
+    if (pstr == nullptr) {
+        line.PutString("(nil)");
+        return;
+    }
+    line.Put((const char *)&pstr[1], pstr[0]);
+}
+
+inline void Render(LineBuffer &line, char c)
+{
+    line.Put(c);
+}
+
+inline void Render(LineBuffer &line, bool value)
+{
+    line.PutString(value ? "true" : "false");
+}
+
+/* Integers, including Boolean (an unsigned char) and enums' values */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+Render(LineBuffer &line, T value)
+{
+    static_assert(sizeof(T) <= sizeof(long), "Debug.c renders at most 32 bits");
+    Detail::PutSigned(line, (long)value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+Render(LineBuffer &line, T value)
+{
+    static_assert(sizeof(T) <= sizeof(unsigned long), "Debug.c renders at most 32 bits");
+    Detail::PutUnsigned(line, (unsigned long)value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type
+Render(LineBuffer &line, T value)
+{
+    Detail::PutSigned(line, (long)value);
+}
+
+template <typename T>
+inline void Render(LineBuffer &line, HexValue<T> hex)
+{
+    Detail::PutHex(line, (unsigned long)hex.value,
+                   std::is_pointer<T>::value ? 8 : (short)(sizeof(T) * 2));
+}
+
+inline void Render(LineBuffer &line, TypeValue type)
+{
+    line.Put('\'');
+    line.Put((char)(type.value >> 24));
+    line.Put((char)(type.value >> 16));
+    line.Put((char)(type.value >> 8));
+    line.Put((char)type.value);
+    line.Put('\'');
+}
+
+/* Any other pointer: its address */
+inline void Render(LineBuffer &line, const void *pointer)
+{
+    Detail::PutHex(line, (unsigned long)pointer, 8);
+}
+
+/* Debug.c has no floating point; convert to an integer first */
+void Render(LineBuffer &line, float value) = delete;
+void Render(LineBuffer &line, double value) = delete;
+
+/*
+ * Put
+ * Render each argument in turn; expanded at compile time into one
+ * renderer call per argument.
+ */
+inline void Put(LineBuffer &)
+{
+}
+
+template <typename First, typename... Rest>
+inline void Put(LineBuffer &line, const First &first, const Rest &... rest)
+{
+    Render(line, first);
+    Put(line, rest...);
+}
+
+/*
+ * Commit
+ * Log a built line at the level given, as DEBUG_AT does, so the
+ * known length is used and an embedded NUL doesn't end the line.
+ */
+inline void Commit(short level, LineBuffer &line)
+{
+    short previous = DebugSetLevel(level);
+
+    DebugLogN(line.Text(), line.Length());
+    DebugSetLevel(previous);
+}
+
+/*
+ * Line / LineAt
+ * Build a line from the arguments and log it, at the current level or
+ * at the one given. Prefer the DEBUG_LINE macros, which also drop the
+ * arguments when DEBUG_ENABLED is 0.
+ */
+template <typename... Args>
+inline void Line(const Args &... args)
+{
+#if DEBUG_ENABLED
+    if (!DEBUG_WANTS(gDebugLevel)) return;
+
+    LineBuffer line;
+    Put(line, args...);
+    DebugLogN(line.Text(), line.Length());
+#endif
+}
+
+template <typename... Args>
+inline void LineAt(short level, const Args &... args)
+{
+#if DEBUG_ENABLED
+    if (!DEBUG_WANTS(level)) return;
+
+    LineBuffer line;
+    Put(line, args...);
+    Commit(level, line);
+#endif
+}
+
+/*
+ * TimerID
+ * A call site's timer ID, registered on first use; id starts as -2,
+ * as in DEBUG_TIMER_SCOPE_BEGIN.
+ */
+inline short TimerID(short &id, const char *name)
+{
+    if (id == -2) id = DebugTimerRegister(name);
+    return id;
+}
+
+/*
+ * ScopeTimer
+ * Adds the time from its construction to the end of the enclosing
+ * scope to a timer's statistics. Unlike DEBUG_TIMER_SCOPE_BEGIN/END,
+ * a return or goto out of the scope is measured too.
+ */
+class ScopeTimer {
+public:
+    explicit ScopeTimer(short timerID) : id_(timerID), start_(DebugTimerBegin()) {}
+    ~ScopeTimer() { DebugTimerEnd(id_, start_); }
+
+    ScopeTimer(const ScopeTimer &) = delete;
+    ScopeTimer &operator=(const ScopeTimer &) = delete;
+
+private:
+    short id_;
+    unsigned long start_;
+};
+
+/*
+ * Scope
+ * Traces entry and exit like DebugTraceEnter/Exit, however the scope
+ * is left, and adds the time inside to a timer as ScopeTimer does.
+ * The clock starts after the entry line is written and the timer is
+ * updated before the exit line, so the logger's own writes stay out
+ * of both the statistics and the time shown.
+ */
+class Scope {
+public:
+    Scope(const char *name, short timerID) : name_(name), id_(timerID)
+    {
+        DebugTraceEnter(name);
+        start_ = DebugTimerBegin();
+    }
+
+    ~Scope()
+    {
+        DebugTimerEnd(id_, start_);
+        DebugTraceExit(name_, start_);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name_;
+    short id_;
+    unsigned long start_;
+};
+
+#if __cplusplus >= 201703L
+
+namespace Format {
+
+/* Widths above this are cut to it, as in DebugLogFormat */
+enum { kWidthMax = 64 };
+
+/* What a segment of a parsed format does */
+enum Kind {
+    kLiteral,       /* Text copied as it stands */
+    kSigned,        /* %d %i */
+    kUnsigned,      /* %u */
+    kHexLower,      /* %x */
+    kHexUpper,      /* %X */
+    kChar,          /* %c */
+    kString         /* %s */
+};
+
+enum Problem {
+    kFormatOK,
+    kFormatUnknownConversion,
+    kFormatLonePercent
+};
+
+/*
+ * Segment
+ * A run of literal text (start and length within the format), or one
+ * conversion with its flags and the argument it takes.
+ */
+struct Segment {
+    Kind kind = kLiteral;
+    short start = 0;
+    short length = 0;
+    short width = 0;
+    bool leftAlign = false;
+    bool zeroPad = false;
+    short slot = 0;
+};
+
+/*
+ * Program
+ * A whole format once parsed. A format of N characters has fewer
+ * than N segments, so the table never overflows.
+ */
+template <std::size_t N>
+struct Program {
+    Segment segments[N] = {};
+    short count = 0;
+    short slots = 0;
+    Problem problem = kFormatOK;
+};
+
+template <std::size_t N>
+constexpr void AddLiteral(Program<N> &program, short start, short length)
+{
+    if (length <= 0) return;
+    program.segments[program.count].kind = kLiteral;
+    program.segments[program.count].start = start;
+    program.segments[program.count].length = length;
+    program.count++;
+}
+
+/*
+ * Parse
+ * Split a format into segments. Only ever run by the compiler; the
+ * syntax is DebugLogFormat's, except that anything it would print as
+ * it stands, such as "%q", is reported as a problem instead.
+ */
+template <std::size_t N>
+constexpr Program<N> Parse(const char *format)
+{
+    Program<N> program{};
+    Segment conversion{};
+    short p = 0;
+    short run = 0;
+
+    while (format[p] != '\0') {
+        if (format[p] != '%') {
+            p++;
+            continue;
+        }
+
+        AddLiteral(program, run, (short)(p - run));
+        p++;
+
+        if (format[p] == '%') {
+            AddLiteral(program, p, 1);
+            p++;
+            run = p;
+            continue;
+        }
+
+        conversion = Segment{};
+        if (format[p] == '-') {
+            conversion.leftAlign = true;
+            p++;
+        }
+        if (format[p] == '0') {
+            conversion.zeroPad = true;
+            p++;
+        }
+        while (format[p] >= '0' && format[p] <= '9') {
+            if (conversion.width < kWidthMax) {
+                conversion.width = (short)(conversion.width * 10 + (format[p] - '0'));
+            }
+            p++;
+        }
+        if (conversion.width > kWidthMax) conversion.width = kWidthMax;
+
+        /* 'l' is accepted for formats shared with DebugLogFormat; the
+           argument's own type decides how it is read */
+        if (format[p] == 'l') p++;
+
+        switch (format[p]) {
+            case 'd':
+            case 'i':
+                conversion.kind = kSigned;
+                break;
+            case 'u':
+                conversion.kind = kUnsigned;
+                break;
+            case 'x':
+                conversion.kind = kHexLower;
+                break;
+            case 'X':
+                conversion.kind = kHexUpper;
+                break;
+            case 'c':
+                conversion.kind = kChar;
+                break;
+            case 's':
+                conversion.kind = kString;
+                break;
+            case '\0':
+                program.problem = kFormatLonePercent;
+                return program;
+            default:
+                program.problem = kFormatUnknownConversion;
+                return program;
+        }
+        conversion.slot = program.slots++;
+        program.segments[program.count++] = conversion;
+        p++;
+        run = p;
+    }
+    AddLiteral(program, run, (short)(p - run));
+    return program;
+}
+
+/* The integer type an argument is read as: an enum's underlying type */
+template <typename T, bool = std::is_enum<T>::value>
+struct IntegerOf {
+    typedef typename std::underlying_type<T>::type type;
+};
+
+template <typename T>
+struct IntegerOf<T, false> {
+    typedef T type;
+};
+
+template <>
+struct IntegerOf<bool, false> {
+    typedef unsigned char type;
+};
+
+/*
+ * PutValue
+ * Render one argument for its conversion. The checks here are what
+ * turn a mismatched argument into a compile error.
+ */
+template <Kind kind, typename Arg>
+inline void PutValue(LineBuffer &line, const Arg &arg)
+{
+    typedef typename std::decay<Arg>::type Value;
+
+    if constexpr (kind == kString) {
+        static_assert(std::is_same<Value, const char *>::value ||
+                      std::is_same<Value, char *>::value ||
+                      std::is_same<Value, const unsigned char *>::value ||
+                      std::is_same<Value, unsigned char *>::value,
+                      "DEBUG_FORMAT: %s takes a C string or a Pascal string");
+        Render(line, (Value)arg);
+    } else if constexpr (kind == kChar) {
+        static_assert(std::is_same<Value, char>::value, "DEBUG_FORMAT: %c takes a char");
+        line.Put(arg);
+    } else if constexpr (!std::is_integral<Value>::value && !std::is_enum<Value>::value) {
+        static_assert(std::is_integral<Value>::value,
+                      "DEBUG_FORMAT: %d, %i, %u, %x and %X take an integer or an enum");
+    } else {
+        typedef typename IntegerOf<Value>::type Integer;
+        typedef typename std::make_unsigned<Integer>::type Bits;
+
+        static_assert(sizeof(Value) <= sizeof(long), "Debug.c renders at most 32 bits");
+
+        if constexpr (kind == kSigned && std::is_signed<Integer>::value) {
+            Detail::PutSigned(line, (long)arg);
+        } else if constexpr (kind == kSigned || kind == kUnsigned) {
+            Detail::PutUnsigned(line, (unsigned long)(Bits)arg);
+        } else {
+            Detail::PutHexDigits(line, (unsigned long)(Bits)arg, kind == kHexUpper);
+        }
+    }
+}
+
+/*
+ * PutSegment
+ * One segment, with everything about it fixed when compiling: a copy
+ * for literal text, a renderer call and any padding for a conversion.
+ */
+template <Kind kind, short start, short length, short width, bool leftAlign,
+          bool zeroPad, short slot, typename Args>
+inline void PutSegment(LineBuffer &line, const char *format, const Args &args)
+{
+    if constexpr (kind == kLiteral) {
+        line.Put(format + start, length);
+    } else if constexpr (width == 0) {
+        PutValue<kind>(line, std::get<slot>(args));
+    } else {
+        short from = line.Length();
+        short len;
+
+        PutValue<kind>(line, std::get<slot>(args));
+        len = (short)(line.Length() - from);
+        if (len >= width) return;
+
+        if (leftAlign) {
+            line.Pad(' ', (short)(width - len));
+        } else if (zeroPad) {
+            /* Zeros go after a minus sign */
+            if (kind == kSigned && line.Text()[from] == '-') from++;
+            line.Insert(from, '0', (short)(width - len));
+        } else {
+            line.Insert(from, ' ', (short)(width - len));
+        }
+    }
+}
+
+/* The parsed format is rebuilt from the lambda here, where the
+   segment numbers are constants, rather than passed in */
+template <std::size_t N, typename F, typename Args, std::size_t... I>
+inline void PutSegments(LineBuffer &line, F format, const char *text,
+                        const Args &args, std::index_sequence<I...>)
+{
+    constexpr Program<N> program = Parse<N>(format());
+
+    (PutSegment<program.segments[I].kind, program.segments[I].start,
+                program.segments[I].length, program.segments[I].width,
+                program.segments[I].leftAlign, program.segments[I].zeroPad,
+                program.segments[I].slot>(line, text, args), ...);
+}
+
+/*
+ * Build
+ * Check the format against the arguments, then render the line.
+ * format is a lambda returning the format string, which is how its
+ * text reaches the compiler as a constant; text is the same string.
+ */
+template <typename F, std::size_t N, typename... Args>
+inline void Build(LineBuffer &line, F format, const char (&text)[N], const Args &... args)
+{
+    constexpr Program<N> program = Parse<N>(format());
+
+    static_assert(program.problem != kFormatUnknownConversion,
+                  "DEBUG_FORMAT: unknown conversion (use %d %i %u %x %X %c %s or %%)");
+    static_assert(program.problem != kFormatLonePercent,
+                  "DEBUG_FORMAT: the format ends with a lone %");
+    static_assert(program.problem != kFormatOK || program.slots == sizeof...(Args),
+                  "DEBUG_FORMAT: the number of arguments doesn't match the format");
+
+    if constexpr (program.problem == kFormatOK && program.slots == sizeof...(Args)) {
+        PutSegments<N>(line, format, text, std::forward_as_tuple(args...),
+                       std::make_index_sequence<program.count>());
+    }
+}
+
+/*
+ * Line / LineAt
+ * Log a formatted line at the current level or at the one given.
+ * Called by the DEBUG_FORMAT macros, which supply the lambda.
+ */
+template <typename F, std::size_t N, typename... Args>
+inline void Line(F format, const char (&text)[N], const Args &... args)
+{
+#if DEBUG_ENABLED
+    if (!DEBUG_WANTS(gDebugLevel)) return;
+
+    LineBuffer line;
+    Build(line, format, text, args...);
+    DebugLogN(line.Text(), line.Length());
+#endif
+}
+
+template <typename F, std::size_t N, typename... Args>
+inline void LineAt(short level, F format, const char (&text)[N], const Args &... args)
+{
+#if DEBUG_ENABLED
+    if (!DEBUG_WANTS(level)) return;
+
+    LineBuffer line;
+    Build(line, format, text, args...);
+    Commit(level, line);
+#endif
+}
+
+} /* namespace Format */
+
+#endif /* __cplusplus >= 201703L */
+
+} /* namespace Debug */
+
+/*
+ * DEBUG_LINE / DEBUG_LINE_AT
+ * Log a line built from any mix of strings, integers, Pascal strings,
+ * pointers and Debug::Hex/Debug::Type values.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError
+ */
+#if DEBUG_ENABLED
+#define DEBUG_LINE(...)             Debug::Line(__VA_ARGS__)
+#define DEBUG_LINE_AT(level, ...)   Debug::LineAt(level, __VA_ARGS__)
+#else
+#define DEBUG_LINE(...)             ((void)0)
+#define DEBUG_LINE_AT(level, ...)   ((void)0)
+#endif
+
+/*
+ * DEBUG_SCOPE / DEBUG_SCOPE_TIMER
+ * DEBUG_SCOPE traces the rest of the enclosing scope, indenting the
+ * lines inside, and adds its time to the timer of the same name.
+ * DEBUG_SCOPE_TIMER only does the timing and writes nothing. Both are
+ * declarations, so each way out of the scope ends them; the timer is
+ * registered on first use and its ID kept in a static. The objects
+ * live on the stack and nothing is virtual.
+ *
+ * name: Scope and timer name (string literal, or __func__)
+ */
+#define DEBUG_CONCAT2_(a, b)    a##b
+#define DEBUG_CONCAT_(a, b)     DEBUG_CONCAT2_(a, b)
+
+#if DEBUG_ENABLED
+#define DEBUG_SCOPE(name) \
+    static short DEBUG_CONCAT_(dbgScopeID_, __LINE__) = -2; \
+    Debug::Scope DEBUG_CONCAT_(dbgScope_, __LINE__)( \
+        name, Debug::TimerID(DEBUG_CONCAT_(dbgScopeID_, __LINE__), name))
+#define DEBUG_SCOPE_TIMER(name) \
+    static short DEBUG_CONCAT_(dbgScopeID_, __LINE__) = -2; \
+    Debug::ScopeTimer DEBUG_CONCAT_(dbgScope_, __LINE__)( \
+        Debug::TimerID(DEBUG_CONCAT_(dbgScopeID_, __LINE__), name))
+#else
+#define DEBUG_SCOPE(name)           ((void)0)
+#define DEBUG_SCOPE_TIMER(name)     ((void)0)
+#endif
+
+/*
+ * DEBUG_FORMAT / DEBUG_FORMAT_AT
+ * Log a line from a DebugLogFormat-style format and its arguments,
+ * checked and laid out when compiling. The format must be a string
+ * literal. Needs C++17.
+ *
+ * level: kDebugLevelTrace to kDebugLevelError
+ */
+#if __cplusplus >= 201703L
+#define DEBUG_FORMAT_TEXT_(format, ...) format
+#if DEBUG_ENABLED
+#define DEBUG_FORMAT(...) \
+    Debug::Format::Line([]() { return DEBUG_FORMAT_TEXT_(__VA_ARGS__, 0); }, __VA_ARGS__)
+#define DEBUG_FORMAT_AT(level, ...) \
+    Debug::Format::LineAt(level, []() { return DEBUG_FORMAT_TEXT_(__VA_ARGS__, 0); }, __VA_ARGS__)
+#else
+#define DEBUG_FORMAT(...)           ((void)0)
+#define DEBUG_FORMAT_AT(level, ...) ((void)0)
+#endif
+#endif
+
+#endif /* DEBUG_HPP */
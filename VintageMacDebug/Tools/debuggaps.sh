@@ -0,0 +1,157 @@
+#!/usr/bin/env bash
+#
+# debuggaps.sh
+#
+# Checks the sequence numbers in a log written with Debug.c's sequence
+# option and reports any lines that are missing: held lines that were
+# lost, text overwritten in a ring sink, or a log cut short. Each run
+# of the logger numbers its lines from 1, so a return to 1 is taken as
+# a new session rather than a gap, as is the first number after a
+# "continued" header in a log rotated by maxFileSize. Lines without a
+# number, such as
+# "(last message repeated N times)", and lines marked "+" because the
+# primary sink didn't take them, are skipped. Check the primary log;
+# a ring or callback copy at another level has expected gaps.
+#
+
+############################################
+# HELP
+############################################
+show_help() {
+    cat <<EOF
+Usage: $0 [options] logfile [...]
+       debugunlz packed.log | $0 [options] -
+
+Options:
+  -q        Print only the summary, not each gap
+  -v        Also list where each session starts
+  -h        Show this help
+
+Exits with 0 when no lines are missing, 2 when there are gaps and 1
+on errors. Logs written with compress must be unpacked first.
+EOF
+}
+
+############################################
+# DEPENDENCY CHECK
+############################################
+required_tools=(perl)
+
+missing=()
+for tool in "${required_tools[@]}"; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        missing+=("$tool")
+    fi
+done
+
+if [[ ${#missing[@]} -gt 0 ]]; then
+    echo "Missing required tools:"
+    for m in "${missing[@]}"; do echo "  - $m"; done
+    echo "Aborting."
+    exit 1
+fi
+
+############################################
+# ARGUMENT PARSING
+############################################
+quiet=0
+verbose=0
+
+while getopts "qvh" opt; do
+    case "$opt" in
+        q) quiet=1 ;;
+        v) verbose=1 ;;
+        h) show_help; exit 0 ;;
+        *) show_help; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [[ $# -eq 0 ]]; then
+    echo "No log specified."
+    show_help
+    exit 1
+fi
+
+############################################
+# CHECK
+############################################
+# Numbers are "#" and 8 hex digits at the start of the line; the Mac
+# writes CR line endings, but converted logs have LF
+QUIET=$quiet VERBOSE=$verbose perl -e '
+    my ($quiet, $verbose) = ($ENV{QUIET}, $ENV{VERBOSE});
+    my $status = 0;
+
+    foreach my $log (@ARGV) {
+        my $f;
+        if ($log eq "-") {
+            $f = \*STDIN;
+        } elsif (!open($f, "<", $log)) {
+            print STDERR "$log - cannot read\n";
+            $status = 1;
+            next;
+        }
+        binmode($f);
+        local $/;
+        my $data = <$f>;
+        close($f) unless $log eq "-";
+
+        if (substr($data, 0, 4) eq "DLZ1") {
+            print STDERR "$log - packed log; unpack it with debugunlz first\n";
+            $status = 1;
+            next;
+        }
+
+        my ($line, $numbered, $gaps, $lost, $sessions) = (0, 0, 0, 0, 0);
+        my $expect = undef;
+        my $continued = 0;
+        foreach (split(/\r\n?|\n/, $data)) {
+            $line++;
+            if (/^=== SESSION \d+ .*continued ===$/) {
+                # Rotated by maxFileSize; earlier lines are in the .old file
+                $continued = 1;
+                $expect = undef;
+                next;
+            }
+            next unless /^#([0-9A-F]{8}) /;
+            my $seq = hex($1);
+            $numbered++;
+
+            if ($seq == 1) {
+                $sessions++;
+                print "$log:$line: session $sessions starts\n" if $verbose;
+            } elsif (!defined $expect && $continued) {
+                $sessions++;
+                printf("%s:%d: session %d continues from the .old file at #%08X\n",
+                       $log, $line, $sessions, $seq) if $verbose;
+            } elsif (!defined $expect) {
+                # Ring sink copy, or the start of the log was lost
+                $gaps++;
+                $lost += $seq - 1;
+                printf("%s:%d: log starts at #%08X; %d earlier lines missing\n",
+                       $log, $line, $seq, $seq - 1) unless $quiet;
+            } elsif ($seq > $expect) {
+                $gaps++;
+                $lost += $seq - $expect;
+                printf("%s:%d: #%08X to #%08X missing (%d lines)\n",
+                       $log, $line, $expect, $seq - 1, $seq - $expect) unless $quiet;
+            } elsif ($seq < $expect) {
+                # kDebugOpenReuse after a crash: the last run'"'"'s leftover text
+                printf("%s:%d: #%08X follows #%08X; older text from here on?\n",
+                       $log, $line, $seq, $expect - 1) unless $quiet;
+            }
+            $expect = ($seq + 1) & 0xFFFFFFFF;
+            $continued = 0;
+        }
+
+        if ($numbered == 0) {
+            print STDERR "$log - no sequence numbers (was sequence set?)\n";
+            $status = 1;
+            next;
+        }
+        printf("%s: %d numbered lines, %d sessions, %d gaps, %d lines missing\n",
+               $log, $numbered, $sessions, $gaps, $lost);
+        $status = 2 if $gaps > 0 && $status == 0;
+    }
+    exit $status;
+' "$@"
@@ -0,0 +1,447 @@
+/*
+ * debugseek.c
+ * Host-side tool for jumping to part of a large log written with
+ * Debug.c's checkpointTicks option
+ *
+ * The logger writes a checkpoint line every so often,
+ *   @CHECKPOINT tick=91544 seq=3120 offset=204877
+ * and DebugClose writes "<log>.idx": "DIDX", then 12 bytes per
+ * checkpoint (tick, sequence number, offset; big-endian 32-bit). This
+ * tool maps the log into memory, finds the checkpoints either side of
+ * the range asked for in the index, and prints only that stretch, so
+ * a log of hundreds of megabytes isn't read from the start.
+ *
+ * Build and run:
+ *   cc -O2 -o debugseek debugseek.c
+ *   ./debugseek -t 91000-92000 soak.log     (ticks 91000 to 92000)
+ *   ./debugseek -s 3000-3500 -l soak.log    (lines 3000 to 3500, LF endings)
+ *   ./debugseek -c soak.log                 (list sessions and checkpoints)
+ *
+ * Lines carry no tick of their own, so a tick range is widened to the
+ * checkpoints around it. A sequence range is exact when the log was
+ * written with the sequence option as well. Each index entry is
+ * checked against the checkpoint line it points at; if the index is
+ * missing or out of date (after a crash, say), the checkpoint lines
+ * are found by scanning the log instead. Logs written with compress
+ * must be unpacked with debugunlz first.
+ *
+ * Copyright © 2026 Pascal Harris. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kMarker         "@CHECKPOINT tick="
+#define kMarkerLen      (sizeof(kMarker) - 1)
+#define kSearchWindow   65536L  /* How far to look for a misplaced checkpoint */
+
+typedef struct Checkpoint {
+    unsigned long tick;
+    unsigned long seq;
+    long offset;
+} Checkpoint;
+
+static const char *gLog;        /* The mapped log */
+static long gLogLen;
+
+static unsigned long ReadBig32(const unsigned char *p)
+{
+    return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+           ((unsigned long)p[2] << 8) | p[3];
+}
+
+/* Offset of the start of the line holding pos */
+static long LineStart(long pos)
+{
+    while (pos > 0 && gLog[pos - 1] != '\r' && gLog[pos - 1] != '\n') pos--;
+    return pos;
+}
+
+/* Offset just past the end of the line starting at pos */
+static long LineEnd(long pos)
+{
+    while (pos < gLogLen && gLog[pos] != '\r' && gLog[pos] != '\n') pos++;
+    if (pos < gLogLen && gLog[pos] == '\r') pos++;
+    if (pos < gLogLen && gLog[pos] == '\n') pos++;
+    return pos;
+}
+
+/* Find the checkpoint marker in the line starting at pos; -1 if absent */
+static long MarkerInLine(long pos)
+{
+    long end = LineEnd(pos);
+    long i;
+
+    for (i = pos; i + (long)kMarkerLen <= end; i++) {
+        if (memcmp(gLog + i, kMarker, kMarkerLen) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * Check that an index entry points at its checkpoint line, or find the
+ * line close by. Returns the line's offset, or -1.
+ */
+static long Locate(const Checkpoint *cp)
+{
+    char want[64];
+    long wantLen;
+    long limit;
+    long pos;
+
+    wantLen = sprintf(want, "%s%lu ", kMarker, cp->tick);
+    pos = cp->offset;
+    if (pos < 0 || pos >= gLogLen) pos = gLogLen > kSearchWindow ? gLogLen - kSearchWindow : 0;
+
+    pos = LineStart(pos);
+    limit = pos + kSearchWindow;
+    if (limit > gLogLen) limit = gLogLen;
+    while (pos < limit) {
+        long m = MarkerInLine(pos);
+
+        if (m >= 0 && m + wantLen <= gLogLen && memcmp(gLog + m, want, (size_t)wantLen) == 0) {
+            return pos;
+        }
+        pos = LineEnd(pos);
+    }
+    return -1;
+}
+
+static Checkpoint *LoadIndex(const char *path, long *count)
+{
+    unsigned char *data;
+    Checkpoint *table;
+    FILE *f;
+    long len;
+    long i;
+
+    f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc((size_t)len + 1);
+    if (data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len ||
+        len < 4 || memcmp(data, "DIDX", 4) != 0) {
+        fprintf(stderr, "%s - not a log index\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+    fclose(f);
+
+    *count = (len - 4) / 12;
+    table = malloc(sizeof(Checkpoint) * (size_t)(*count + 1));
+    for (i = 0; i < *count; i++) {
+        const unsigned char *p = data + 4 + i * 12;
+
+        table[i].tick = ReadBig32(p);
+        table[i].seq = ReadBig32(p + 4);
+        table[i].offset = (long)ReadBig32(p + 8);
+    }
+    free(data);
+    return table;
+}
+
+/* No usable index: collect the checkpoint lines by reading the log */
+static Checkpoint *ScanLog(long *count)
+{
+    Checkpoint *table = NULL;
+    long size = 0;
+    long pos = 0;
+    long m;
+
+    *count = 0;
+    while (pos < gLogLen) {
+        m = MarkerInLine(pos);
+        if (m >= 0) {
+            if (*count == size) {
+                size = size ? size * 2 : 256;
+                table = realloc(table, sizeof(Checkpoint) * (size_t)size);
+            }
+            table[*count].offset = pos;
+            table[*count].tick = strtoul(gLog + m + kMarkerLen, NULL, 10);
+            {
+                const char *s = gLog + m;
+                const char *end = gLog + LineEnd(pos);
+
+                while (s < end - 4 && memcmp(s, "seq=", 4) != 0) s++;
+                table[*count].seq = s < end - 4 ? strtoul(s + 4, NULL, 10) : 0;
+            }
+            (*count)++;
+        }
+        pos = LineEnd(pos);
+    }
+    return table;
+}
+
+/* Sequence number stamped at the start of a line, or 0 */
+static unsigned long LineSeq(long pos)
+{
+    char digits[9];
+
+    if (pos + 10 > gLogLen || gLog[pos] != '#' || gLog[pos + 9] != ' ') return 0;
+    memcpy(digits, gLog + pos + 1, 8);
+    digits[8] = '\0';
+    return strtoul(digits, NULL, 16);
+}
+
+/* Session header line ("=== SESSION ...", numbered or not) at pos */
+static int IsSessionHeader(long pos)
+{
+    if (LineSeq(pos) != 0) pos += 10;
+    return pos + 12 <= gLogLen && memcmp(gLog + pos, "=== SESSION ", 12) == 0;
+}
+
+/*
+ * The session header in the 1 KB before pos, above limit, or -1. A
+ * session's first checkpoint follows its header closely.
+ */
+static long HeaderBefore(long pos, long limit)
+{
+    long at = pos;
+
+    while (at > limit && pos - at < 1024) {
+        at = LineStart(at - 1);
+        if (IsSessionHeader(at)) return at;
+    }
+    return -1;
+}
+
+static void WriteRange(long from, long to, int toLF)
+{
+    long i;
+
+    if (!toLF) {
+        fwrite(gLog + from, 1, (size_t)(to - from), stdout);
+        return;
+    }
+    for (i = from; i < to; i++) {
+        putchar(gLog[i] == '\r' ? '\n' : gLog[i]);
+    }
+}
+
+static int ParseRange(const char *text, unsigned long *from, unsigned long *to)
+{
+    char *end;
+
+    *from = strtoul(text, &end, 10);
+    if (end == text) return -1;
+    if (*end == '-') {
+        text = end + 1;
+        *to = strtoul(text, &end, 10);
+        if (end == text) return -1;
+    } else {
+        *to = *from;
+    }
+    return *end == '\0' && *from <= *to ? 0 : -1;
+}
+
+static void ShowHelp(const char *name)
+{
+    printf("Usage: %s [options] log\n\n", name);
+    printf("Options:\n");
+    printf("  -t from[-to]  Lines logged between these tick counts\n");
+    printf("  -s from[-to]  Lines with these sequence numbers\n");
+    printf("  -S n          Session n of an append-mode log (default: the last)\n");
+    printf("  -i index      Index file (default: log.idx)\n");
+    printf("  -c            List sessions and checkpoints instead\n");
+    printf("  -l            Turn the Mac's CR line endings into LF\n");
+    printf("  -h            Show this help\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *logPath = NULL;
+    const char *indexPath = NULL;
+    char defaultIndex[1024];
+    Checkpoint *table;
+    long count = 0;
+    long first;
+    long last;
+    long start;
+    long stop;
+    long i;
+    long pos;
+    unsigned long from = 0;
+    unsigned long to = 0;
+    unsigned long seq;
+    int bySeq = -1;         /* -1 = no range, 0 = ticks, 1 = sequence */
+    int session = 0;
+    int sessions;
+    int list = 0;
+    int toLF = 0;
+    int opt;
+    int fd;
+    struct stat st;
+
+    while ((opt = getopt(argc, argv, "t:s:S:i:clh")) != -1) {
+        switch (opt) {
+            case 't':
+            case 's':
+                if (ParseRange(optarg, &from, &to) != 0) {
+                    fprintf(stderr, "Bad range: %s\n", optarg);
+                    return 1;
+                }
+                bySeq = opt == 's';
+                break;
+            case 'S': session = atoi(optarg); break;
+            case 'i': indexPath = optarg; break;
+            case 'c': list = 1; break;
+            case 'l': toLF = 1; break;
+            case 'h': ShowHelp(argv[0]); return 0;
+            default: ShowHelp(argv[0]); return 1;
+        }
+    }
+    if (optind != argc - 1 || (bySeq < 0 && !list)) {
+        ShowHelp(argv[0]);
+        return 1;
+    }
+    logPath = argv[optind];
+
+    fd = open(logPath, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s - cannot read\n", logPath);
+        return 1;
+    }
+    gLogLen = (long)st.st_size;
+    gLog = mmap(NULL, (size_t)gLogLen, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (gLog == MAP_FAILED) {
+        fprintf(stderr, "%s - cannot map\n", logPath);
+        return 1;
+    }
+    if (gLogLen >= 4 && memcmp(gLog, "DLZ1", 4) == 0) {
+        fprintf(stderr, "%s - packed log; unpack it with debugunlz first\n", logPath);
+        return 1;
+    }
+
+    if (indexPath == NULL) {
+        snprintf(defaultIndex, sizeof(defaultIndex), "%s.idx", logPath);
+        indexPath = defaultIndex;
+    }
+    table = LoadIndex(indexPath, &count);
+
+    /* An index that doesn't match the log is no use */
+    if (table != NULL && count > 0 &&
+        (Locate(&table[0]) < 0 || Locate(&table[count - 1]) < 0)) {
+        fprintf(stderr, "%s - doesn't match the log; scanning instead\n", indexPath);
+        free(table);
+        table = NULL;
+    }
+    if (table == NULL || count == 0) {
+        free(table);
+        table = ScanLog(&count);
+        if (count == 0) {
+            fprintf(stderr, "%s - no checkpoints (was checkpointTicks set?)\n", logPath);
+            return 1;
+        }
+    }
+
+    /* Sequence numbers start again with each session */
+    sessions = 1;
+    for (i = 1; i < count; i++) {
+        if (table[i].seq <= table[i - 1].seq) sessions++;
+    }
+
+    if (list) {
+        int n = 1;
+
+        for (i = 0; i < count; i++) {
+            if (i == 0 || table[i].seq <= table[i - 1].seq) {
+                printf("Session %d\n", n++);
+            }
+            printf("  tick %10lu  seq %8lu  offset %10ld\n",
+                   table[i].tick, table[i].seq, table[i].offset);
+        }
+        return 0;
+    }
+
+    if (session <= 0) session = sessions;
+    if (session > sessions) {
+        fprintf(stderr, "%s - has %d sessions\n", logPath, sessions);
+        return 1;
+    }
+    first = 0;
+    for (i = 1; i < count && session > 1; i++) {
+        if (table[i].seq <= table[i - 1].seq && --session == 1) first = i;
+    }
+    if (session > 1) first = i;
+    for (last = first; last + 1 < count && table[last + 1].seq > table[last].seq; last++) {
+    }
+
+    /* Start: the last checkpoint at or before the range (binary search) */
+    {
+        long lo = first;
+        long hi = last;
+
+        while (lo < hi) {
+            long mid = (lo + hi + 1) / 2;
+            unsigned long key = bySeq ? table[mid].seq : table[mid].tick;
+
+            if (key <= from) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if ((bySeq ? table[lo].seq : table[lo].tick) > from) {
+            /* Begins before the first checkpoint: from the session's header */
+            start = 0;
+            if (first > 0) {
+                pos = Locate(&table[first]);
+                start = HeaderBefore(pos, 0);
+                if (start < 0) start = pos;
+            }
+        } else {
+            for (i = lo; i >= first; i--) {
+                start = Locate(&table[i]);
+                if (start >= 0) break;
+            }
+            if (i < first) start = first == 0 ? 0 : Locate(&table[first]);
+        }
+    }
+
+    /* Stop: the first checkpoint after the range, else the session's end */
+    stop = -1;
+    for (i = first; i <= last; i++) {
+        unsigned long key = bySeq ? table[i].seq : table[i].tick;
+
+        if (key > to) {
+            stop = Locate(&table[i]);
+            if (stop >= 0) break;
+        }
+    }
+    if (stop < 0) {
+        stop = gLogLen;
+        if (last + 1 < count) {
+            /* The next session's header comes before its first checkpoint */
+            stop = Locate(&table[last + 1]);
+            if (stop < 0) stop = gLogLen;
+            pos = HeaderBefore(stop, start);
+            if (pos >= 0) stop = pos;
+        }
+    }
+    if (start < 0 || stop <= start) return 0;
+
+    /* Numbered logs have a number on the checkpoint lines; the range
+       may start at a session header without one */
+    if (bySeq != 1 || LineSeq(Locate(&table[first])) == 0) {
+        WriteRange(start, stop, toLF);
+        return 0;
+    }
+
+    /* Stamped lines: exactly the numbers asked for */
+    for (pos = start; pos < stop; pos = LineEnd(pos)) {
+        seq = LineSeq(pos);
+        if (seq != 0 && seq > to) break;
+        if (seq == 0 || seq >= from) {
+            WriteRange(pos, LineEnd(pos), toLF);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+#!/usr/bin/env bash
+#
+# debugstrings.sh
+#
+# Build step for Debug.c message IDs. Scans C sources for
+# DEBUG_MSG(id, "literal") calls and generates DebugStrings.h (the IDs)
+# and DebugStrings.c (a table of compile-time lengths and texts).
+# Also decodes logs written with binaryIDs back into text.
+#
+
+############################################
+# HELP
+############################################
+show_help() {
+    cat <<EOF
+Usage: $0 [options] file_or_directory [...]
+       $0 -d DebugStrings.c logfile [...]
+
+Options:
+  -r        Process directories recursively
+  -o dir    Write DebugStrings.h and DebugStrings.c to dir (default .)
+  -d table  Decode ID records in the given logs using a generated
+            DebugStrings.c, writing the text to standard output
+  -v        Verbose output
+  -h        Show this help
+
+Build DebugStrings.c with DEBUG_BINARY_ONLY defined to leave the texts
+out of the application entirely (binaryIDs mode only).
+EOF
+}
+
+############################################
+# DEPENDENCY CHECK
+############################################
+required_tools=(perl find)
+
+missing=()
+for tool in "${required_tools[@]}"; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        missing+=("$tool")
+    fi
+done
+
+if [[ ${#missing[@]} -gt 0 ]]; then
+    echo "Missing required tools:"
+    for m in "${missing[@]}"; do echo "  - $m"; done
+    echo "Aborting."
+    exit 1
+fi
+
+############################################
+# ARGUMENT PARSING
+############################################
+recursive=0
+verbose=0
+out_dir="."
+decode_table=""
+
+while getopts "ro:d:vh" opt; do
+    case "$opt" in
+        r) recursive=1 ;;
+        o) out_dir="$OPTARG" ;;
+        d) decode_table="$OPTARG" ;;
+        v) verbose=1 ;;
+        h) show_help; exit 0 ;;
+        *) show_help; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [[ $# -eq 0 ]]; then
+    echo "No files or directories specified."
+    show_help
+    exit 1
+fi
+
+############################################
+# DECODE
+############################################
+if [[ -n "$decode_table" ]]; then
+    if [[ ! -r "$decode_table" ]]; then
+        echo "$decode_table - cannot read table"
+        exit 1
+    fi
+
+    # Table lines look like:  /* 12 */ { sizeof("text") - 1, DEBUG_STRING_TEXT("text") },
+    perl -e '
+        my $table = shift @ARGV;
+        my %text;
+        open(my $t, "<", $table) or die "$table: $!\n";
+        while (<$t>) {
+            next unless m{/\* (\d+) \*/ \{ sizeof\(("(?:[^"\\]|\\.)*")\)};
+            my ($id, $lit) = ($1, $2);
+            $lit =~ s/^"//; $lit =~ s/"$//;
+            $lit =~ s/\\(x[0-9A-Fa-f]{1,2}|[0-7]{1,3}|.)/
+                my $e = $1;
+                $e =~ m{^x} ? chr(hex(substr($e, 1))) :
+                $e =~ m{^[0-7]} ? chr(oct($e)) :
+                { n => "\n", r => "\r", t => "\t", 0 => "\0" }->{$e} || $e/ge;
+            $text{$id} = $lit;
+        }
+        close($t);
+
+        binmode(STDOUT);
+        foreach my $log (@ARGV) {
+            open(my $f, "<", $log) or do { print STDERR "$log - cannot read\n"; next; };
+            binmode($f);
+            local $/;
+            my $data = <$f>;
+            close($f);
+            $data =~ s/\x01([\x80-\xff])([\x80-\xff])/
+                my $id = ((ord($1) & 0x7f) << 7) | (ord($2) & 0x7f);
+                exists $text{$id} ? $text{$id} : "(unknown message $id)"/ge;
+            print $data;
+        }
+    ' "$decode_table" "$@"
+    exit $?
+fi
+
+############################################
+# COLLECT SOURCES
+############################################
+sources=()
+for target in "$@"; do
+    if [[ -d "$target" ]]; then
+        if [[ $recursive -eq 1 ]]; then
+            while IFS= read -r f; do sources+=("$f"); done < <(find "$target" -type f \( -name '*.c' -o -name '*.h' -o -name '*.cp' -o -name '*.cpp' \))
+        else
+            for f in "$target"/*.c "$target"/*.h "$target"/*.cp "$target"/*.cpp; do [[ -f "$f" ]] && sources+=("$f"); done
+        fi
+    elif [[ -f "$target" ]]; then
+        sources+=("$target")
+    else
+        echo "$target - not found"
+    fi
+done
+
+if [[ ${#sources[@]} -eq 0 ]]; then
+    echo "No source files found."
+    exit 1
+fi
+
+if [[ ! -d "$out_dir" ]]; then
+    echo "$out_dir - not a directory"
+    exit 1
+fi
+
+############################################
+# GENERATE
+############################################
+# IDs are given in order of identifier name, so they only change when
+# messages are added or removed. Decode logs with the table from the
+# same build.
+VERBOSE=$verbose perl -e '
+    my $out = shift @ARGV;
+    my (%lit, %where);
+    my $errors = 0;
+
+    foreach my $src (@ARGV) {
+        next if $src =~ m{(^|/)(Debug|DebugStrings)\.[ch]$};
+        open(my $f, "<", $src) or do { print STDERR "$src - cannot read\n"; next; };
+        local $/;
+        my $code = <$f>;
+        close($f);
+
+        while ($code =~ /\bDEBUG_MSG\s*\(\s*(\w+)\s*,\s*((?:"(?:[^"\\\n]|\\.)*"\s*)+)\)/g) {
+            my ($id, $text) = ($1, $2);
+            my $line = 1 + (substr($code, 0, $-[0]) =~ tr/\n//);
+
+            # Join adjacent literals into one
+            my @parts = ($text =~ /"((?:[^"\\\n]|\\.)*)"/g);
+            $text = "\"" . join("", @parts) . "\"";
+
+            if (exists $lit{$id} && $lit{$id} ne $text) {
+                print STDERR "$src:$line - $id already used for $lit{$id} at $where{$id}\n";
+                $errors++;
+                next;
+            }
+            $lit{$id} = $text;
+            $where{$id} = "$src:$line";
+        }
+    }
+    exit 1 if $errors;
+
+    my @ids = sort keys %lit;
+    if (@ids > 0x4000) {
+        print STDERR "Too many messages (" . scalar(@ids) . ", maximum 16384)\n";
+        exit 1;
+    }
+
+    open(my $h, ">", "$out/DebugStrings.h") or die "$out/DebugStrings.h: $!\n";
+    print $h "/*\n * DebugStrings.h\n * Generated by debugstrings.sh - do not edit.\n */\n\n";
+    print $h "#ifndef DEBUGSTRINGS_H\n#define DEBUGSTRINGS_H\n\n#include \"Debug.h\"\n\nenum {\n";
+    for my $i (0 .. $#ids) {
+        print $h "    $ids[$i] = $i,\n";
+    }
+    print $h "    kDebugStringCount = " . scalar(@ids) . "\n};\n\n";
+    print $h "extern const DebugString gDebugStrings[];\n\n#endif /* DEBUGSTRINGS_H */\n";
+    close($h);
+
+    open(my $c, ">", "$out/DebugStrings.c") or die "$out/DebugStrings.c: $!\n";
+    print $c "/*\n * DebugStrings.c\n * Generated by debugstrings.sh - do not edit.\n */\n\n";
+    print $c "#include \"DebugStrings.h\"\n\n";
+    print $c "#ifdef DEBUG_BINARY_ONLY\n#define DEBUG_STRING_TEXT(s) nil\n#else\n#define DEBUG_STRING_TEXT(s) s\n#endif\n\n";
+    print $c "const DebugString gDebugStrings[] = {\n";
+    for my $i (0 .. $#ids) {
+        my $t = $lit{$ids[$i]};
+        print $c "    /* $i */ { sizeof($t) - 1, DEBUG_STRING_TEXT($t) },\n";
+    }
+    print $c "    { 0, nil }\n};\n";
+    close($c);
+
+    if ($ENV{VERBOSE}) {
+        print "$_ = $lit{$_} ($where{$_})\n" foreach @ids;
+    }
+    print "$out/DebugStrings.h, $out/DebugStrings.c - " . scalar(@ids) . " messages\n";
+' "$out_dir" "${sources[@]}"
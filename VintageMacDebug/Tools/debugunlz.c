@@ -0,0 +1,169 @@
+/*
+ * debugunlz.c
+ * Host-side decompressor for logs written with Debug.c's compress option
+ *
+ * A packed log starts with the four bytes "DLZ1", followed by one
+ * block per buffer the logger flushed. Each block has a 4-byte header
+ * (text length, then packed length, both 16-bit big-endian) and then
+ * either LZSS data or, when the two lengths are equal, the text as it
+ * is. The output is the exact CR-terminated text the logger was given.
+ *
+ * Build and run:
+ *   cc -O2 -o debugunlz debugunlz.c
+ *   ./debugunlz debug.txt > debug.log        (Mac CR line endings kept)
+ *   ./debugunlz -l debug.txt | less          (CR turned into LF)
+ *
+ * With no file name, reads standard input. A log cut short by a crash
+ * is decoded up to the last whole block, and a warning is printed.
+ * Keep UnpackBlock in step with PackBlock in Debug.c.
+ *
+ * Copyright © 2026 Pascal Harris. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define kPackMagic      "DLZ1"
+#define kPackHeader     4
+#define kBlockMax       4096    /* kDebugBufSize */
+#define kMinMatch       3
+
+/*
+ * UnpackBlock
+ * Expand one LZSS block into exactly textLen bytes.
+ * Returns: 0, or -1 if the block is damaged
+ */
+static int UnpackBlock(const unsigned char *src, long packedLen,
+                       unsigned char *dst, long textLen)
+{
+    long in = 0;
+    long out = 0;
+    unsigned flags = 0;
+    int bit = 8;
+    long offset;
+    int length;
+
+    while (out < textLen) {
+        if (bit == 8) {
+            if (in >= packedLen) return -1;
+            flags = src[in++];
+            bit = 0;
+        }
+        if (flags & (1u << bit)) {
+            if (in + 2 > packedLen) return -1;
+            offset = ((long)src[in] << 4) | (src[in + 1] >> 4);
+            length = (src[in + 1] & 0x0F) + kMinMatch;
+            in += 2;
+            if (offset == 0 || offset > out || out + length > textLen) return -1;
+
+            /* Byte at a time: a match may overlap its own output */
+            while (length-- > 0) {
+                dst[out] = dst[out - offset];
+                out++;
+            }
+        } else {
+            if (in >= packedLen) return -1;
+            dst[out++] = src[in++];
+        }
+        bit++;
+    }
+    return in == packedLen ? 0 : -1;
+}
+
+static void WriteText(const unsigned char *text, long len, int toLF, FILE *out)
+{
+    long i;
+
+    if (!toLF) {
+        fwrite(text, 1, (size_t)len, out);
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        putc(text[i] == '\r' ? '\n' : text[i], out);
+    }
+}
+
+static void ShowHelp(const char *name)
+{
+    printf("Usage: %s [-l] [file]\n\n", name);
+    printf("Options:\n");
+    printf("  -l   Turn the Mac's CR line endings into LF\n");
+    printf("  -h   Show this help\n");
+}
+
+int main(int argc, char **argv)
+{
+    static unsigned char packed[kBlockMax + 8];
+    static unsigned char text[kBlockMax];
+    unsigned char header[kPackHeader];
+    const char *path = NULL;
+    FILE *in = stdin;
+    long textLen;
+    long packedLen;
+    long blocks = 0;
+    int toLF = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0) {
+            toLF = 1;
+        } else if (strcmp(argv[i], "-h") == 0) {
+            ShowHelp(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            ShowHelp(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path != NULL) {
+        in = fopen(path, "rb");
+        if (in == NULL) {
+            fprintf(stderr, "%s - cannot open\n", path);
+            return 1;
+        }
+    } else {
+        path = "standard input";
+    }
+
+    if (fread(header, 1, kPackHeader, in) != kPackHeader ||
+        memcmp(header, kPackMagic, kPackHeader) != 0) {
+        fprintf(stderr, "%s - not a packed log (no %s at the start)\n", path, kPackMagic);
+        return 1;
+    }
+
+    for (;;) {
+        size_t got = fread(header, 1, kPackHeader, in);
+
+        if (got == 0) break;
+        if (got != kPackHeader) {
+            fprintf(stderr, "%s - ends inside a block header after %ld blocks\n", path, blocks);
+            return 2;
+        }
+        textLen = ((long)header[0] << 8) | header[1];
+        packedLen = ((long)header[2] << 8) | header[3];
+        if (textLen == 0 || textLen > kBlockMax || packedLen > textLen) {
+            fprintf(stderr, "%s - bad block header after %ld blocks\n", path, blocks);
+            return 2;
+        }
+        if (fread(packed, 1, (size_t)packedLen, in) != (size_t)packedLen) {
+            fprintf(stderr, "%s - ends inside block %ld\n", path, blocks + 1);
+            return 2;
+        }
+
+        if (packedLen == textLen) {
+            WriteText(packed, textLen, toLF, stdout);
+        } else if (UnpackBlock(packed, packedLen, text, textLen) == 0) {
+            WriteText(text, textLen, toLF, stdout);
+        } else {
+            fprintf(stderr, "%s - block %ld is damaged\n", path, blocks + 1);
+            return 2;
+        }
+        blocks++;
+    }
+
+    if (in != stdin) fclose(in);
+    return 0;
+}
@@ -0,0 +1,354 @@
+/*
+ * lzbench.c
+ * Host-side benchmark for Debug.c's compress option
+ *
+ * Packs a log the way the logger does, one block per flushed buffer,
+ * unpacks it again and checks the text comes back byte for byte. It
+ * reports the bytes that reach the disk with and without packing, the
+ * host throughput of both directions, and the work done per input
+ * byte (hash probes and byte compares), which is what decides the
+ * cost on a 68000. It also shows how much text per second a slow
+ * device can take either way, when the device rather than the CPU is
+ * the limit.
+ *
+ * Build and run:
+ *   cc -O2 -o lzbench lzbench.c
+ *   ./lzbench                     (a generated log of typical lines)
+ *   ./lzbench -b 1024 debug.txt   (a real, unpacked log; 1 KB flushes)
+ *
+ * PackBlock below is a copy of the one in Debug.c, with counters, and
+ * UnpackBlock a copy of the one in debugunlz.c. Keep them in step.
+ *
+ * Copyright © 2026 Pascal Harris. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kBlockMax       4096    /* kDebugBufSize */
+#define kPackHeader     4
+#define kLZHashSize     1024
+#define kLZMinMatch     3
+#define kLZMaxMatch     18
+#define kLZMaxOffset    4095
+
+/* Work counts */
+static unsigned long gProbes;   /* Hash table lookups */
+static unsigned long gCompares; /* Bytes compared while matching */
+
+static short gLZTable[kLZHashSize];
+
+/* Copy of PackBlock from Debug.c, with counters */
+static long PackBlock(const unsigned char *src, long len, unsigned char *dst)
+{
+    long pos = 0;
+    long out = 0;
+    long flagAt = 0;
+    short bit = 8;
+    short hash;
+    short cand;
+    short offset;
+    short matchLen;
+    short maxLen;
+
+    while (pos < len) {
+        if (bit == 8) {
+            flagAt = out++;
+            dst[flagAt] = 0;
+            bit = 0;
+        }
+
+        matchLen = 0;
+        cand = 0;
+        if (pos + kLZMinMatch <= len) {
+            hash = ((src[pos] << 5) ^ (src[pos + 1] << 2) ^ src[pos + 2]) &
+                   (kLZHashSize - 1);
+            cand = gLZTable[hash];
+            gLZTable[hash] = (short)pos;
+            gProbes++;
+            if (cand >= 0 && cand < pos && pos - cand <= kLZMaxOffset) {
+                maxLen = kLZMaxMatch;
+                if (len - pos < maxLen) maxLen = (short)(len - pos);
+                while (matchLen < maxLen && src[cand + matchLen] == src[pos + matchLen]) {
+                    matchLen++;
+                    gCompares++;
+                }
+                gCompares++;
+            }
+        }
+
+        if (matchLen >= kLZMinMatch) {
+            offset = (short)(pos - cand);
+            dst[flagAt] |= (unsigned char)(1 << bit);
+            dst[out++] = (unsigned char)(offset >> 4);
+            dst[out++] = (unsigned char)(((offset & 0x0F) << 4) | (matchLen - kLZMinMatch));
+            pos += matchLen;
+        } else {
+            dst[out++] = src[pos++];
+        }
+        bit++;
+
+        if (out >= len) return len;
+    }
+    return out;
+}
+
+/* Copy of UnpackBlock from debugunlz.c */
+static int UnpackBlock(const unsigned char *src, long packedLen,
+                       unsigned char *dst, long textLen)
+{
+    long in = 0;
+    long out = 0;
+    unsigned flags = 0;
+    int bit = 8;
+    long offset;
+    int length;
+
+    while (out < textLen) {
+        if (bit == 8) {
+            if (in >= packedLen) return -1;
+            flags = src[in++];
+            bit = 0;
+        }
+        if (flags & (1u << bit)) {
+            if (in + 2 > packedLen) return -1;
+            offset = ((long)src[in] << 4) | (src[in + 1] >> 4);
+            length = (src[in + 1] & 0x0F) + kLZMinMatch;
+            in += 2;
+            if (offset == 0 || offset > out || out + length > textLen) return -1;
+            while (length-- > 0) {
+                dst[out] = dst[out - offset];
+                out++;
+            }
+        } else {
+            if (in >= packedLen) return -1;
+            dst[out++] = src[in++];
+        }
+        bit++;
+    }
+    return in == packedLen ? 0 : -1;
+}
+
+/* Simple repeatable value generator (xorshift) */
+static unsigned long gSeed = 2463534242UL;
+
+static unsigned long NextValue(void)
+{
+    gSeed ^= (gSeed << 13) & 0xFFFFFFFFUL;
+    gSeed ^= gSeed >> 17;
+    gSeed ^= (gSeed << 5) & 0xFFFFFFFFUL;
+    return gSeed;
+}
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A log of the kind the logger writes: traces, values, handles, timings */
+static long MakeLog(unsigned char *buf, long size)
+{
+    static const char *const names[] = {
+        "DrawWindow", "HandleEvent", "UpdateScroll", "LoadDocument", "SaveDocument"
+    };
+    char line[128];
+    long len = 0;
+    int depth = 0;
+    int n;
+    unsigned long v;
+
+    n = sprintf(line, "DEBUG LOG INITIALIZED\r");
+    memcpy(buf, line, (size_t)n);
+    len = n;
+
+    while (len < size - (long)sizeof(line)) {
+        v = NextValue();
+        switch (v % 8) {
+            case 0:
+                n = sprintf(line, "%*s> %s\r", depth * 2, "", names[(v >> 8) % 5]);
+                if (depth < 6) depth++;
+                break;
+            case 1:
+                if (depth > 0) depth--;
+                n = sprintf(line, "%*s< %s\r", depth * 2, "", names[(v >> 8) % 5]);
+                break;
+            case 2:
+                n = sprintf(line, "%*sProcessing item: %lu\r", depth * 2, "", (v >> 8) % 1000);
+                break;
+            case 3:
+                n = sprintf(line, "%*sHandle: 0x%08lX\r", depth * 2, "", 0x00120000UL + ((v >> 4) & 0xFFF0));
+                break;
+            case 4:
+                n = sprintf(line, "TIMER %s %lu us\r", names[(v >> 8) % 5], (v >> 12) % 50000);
+                break;
+            case 5:
+                n = sprintf(line, "%*sWaiting for reply\r", depth * 2, "");
+                break;
+            case 6:
+                n = sprintf(line, "FreeMem: %lu  StackSpace: %lu\r", 400000 + (v >> 8) % 20000, 20000 + (v >> 16) % 2000);
+                break;
+            default:
+                n = sprintf(line, "%*sWARN: event %lu queue length %lu\r", depth * 2, "", (v >> 8) % 24, (v >> 20) % 16);
+                break;
+        }
+        memcpy(buf + len, line, (size_t)n);
+        len += n;
+    }
+    return len;
+}
+
+static long LoadFile(const char *path, unsigned char **buf)
+{
+    FILE *f = fopen(path, "rb");
+    long len;
+
+    if (f == NULL) return -1;
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *buf = malloc((size_t)len + 1);
+    if (*buf == NULL || fread(*buf, 1, (size_t)len, f) != (size_t)len) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    static const long kDeviceRates[] = { 20000, 25000, 150000 };
+    static const char *const kDeviceNames[] = {
+        "floppy (approx.)", "LocalTalk server", "SCSI disk (approx.)"
+    };
+    unsigned char *text = NULL;
+    unsigned char *packed;
+    unsigned char *back;
+    unsigned char block[kBlockMax + 4];     /* PackBlock may run 2 bytes over before giving up */
+    long textLen;
+    long blockSize = kBlockMax;
+    long packedLen;
+    long pos;
+    long chunk;
+    long n;
+    long blocks;
+    long outPos;
+    double start;
+    double packTime;
+    double unpackTime;
+    double ratio;
+    int rounds = 20;
+    int r;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            blockSize = atol(argv[++i]);
+            if (blockSize < 16 || blockSize > kBlockMax) {
+                printf("Block size must be 16 to %d\n", kBlockMax);
+                return 1;
+            }
+        } else if (text == NULL) {
+            textLen = LoadFile(argv[i], &text);
+            if (textLen <= 0) {
+                printf("%s - cannot read\n", argv[i]);
+                return 1;
+            }
+            printf("Log: %s\n", argv[i]);
+        } else {
+            printf("Usage: %s [-b blocksize] [log]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (text == NULL) {
+        text = malloc(1L << 20);
+        textLen = MakeLog(text, 1L << 20);
+        printf("Log: %ld bytes of generated lines\n", textLen);
+    }
+    printf("Flushed blocks: %ld bytes\n\n", blockSize);
+
+    /* Worst case: every block stored as it is, plus headers and magic */
+    packed = malloc((size_t)(textLen + (textLen / blockSize + 1) * (kPackHeader + 4) + 4));
+    back = malloc((size_t)textLen);
+
+    /* Pack */
+    gProbes = gCompares = 0;
+    packedLen = 0;
+    blocks = 0;
+    start = NowSeconds();
+    for (r = 0; r < rounds; r++) {
+        packedLen = 4;
+        blocks = 0;
+        for (pos = 0; pos < textLen; pos += chunk) {
+            chunk = textLen - pos;
+            if (chunk > blockSize) chunk = blockSize;
+            n = PackBlock(text + pos, chunk, block);
+            packed[packedLen++] = (unsigned char)(chunk >> 8);
+            packed[packedLen++] = (unsigned char)chunk;
+            packed[packedLen++] = (unsigned char)(n >> 8);
+            packed[packedLen++] = (unsigned char)n;
+            memcpy(packed + packedLen, n == chunk ? text + pos : block, (size_t)n);
+            packedLen += n;
+            blocks++;
+        }
+    }
+    packTime = (NowSeconds() - start) / rounds;
+    memcpy(packed, "DLZ1", 4);
+
+    /* Unpack and check */
+    start = NowSeconds();
+    for (r = 0; r < rounds; r++) {
+        pos = 4;
+        outPos = 0;
+        while (pos < packedLen) {
+            chunk = ((long)packed[pos] << 8) | packed[pos + 1];
+            n = ((long)packed[pos + 2] << 8) | packed[pos + 3];
+            pos += kPackHeader;
+            if (n == chunk) {
+                memcpy(back + outPos, packed + pos, (size_t)n);
+            } else if (UnpackBlock(packed + pos, n, back + outPos, chunk) != 0) {
+                printf("Block at %ld failed to unpack\n", pos);
+                return 1;
+            }
+            pos += n;
+            outPos += chunk;
+        }
+    }
+    unpackTime = (NowSeconds() - start) / rounds;
+
+    if (outPos != textLen || memcmp(back, text, (size_t)textLen) != 0) {
+        printf("Round trip FAILED\n");
+        return 1;
+    }
+    printf("Round trip verified (%ld blocks)\n\n", blocks);
+
+    ratio = (double)textLen / packedLen;
+    printf("Bytes on disk:\n");
+    printf("  plain     %9ld\n", textLen);
+    printf("  packed    %9ld   (%.1f%% of plain, %.2f:1)\n\n",
+           packedLen, 100.0 * packedLen / textLen, ratio);
+
+    printf("Host throughput (MB of text per second):\n");
+    printf("  pack      %9.1f\n", textLen / packTime / 1e6);
+    printf("  unpack    %9.1f\n\n", textLen / unpackTime / 1e6);
+
+    printf("Work per text byte: %.2f hash probes, %.2f byte compares\n\n",
+           (double)gProbes / ((double)textLen * rounds),
+           (double)gCompares / ((double)textLen * rounds));
+
+    printf("Text per second a device can take, when it is the limit:\n");
+    for (i = 0; i < 3; i++) {
+        printf("  %-20s plain %7ld   packed %7.0f bytes/s\n",
+               kDeviceNames[i], kDeviceRates[i], kDeviceRates[i] * ratio);
+    }
+
+    free(text);
+    free(packed);
+    free(back);
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * numbench.c
+ * Host-side benchmark for Debug.c's integer-to-text conversion
+ *
+ * Compares the original "% 10" / "/ 10" digit loop with the
+ * FormatUnsigned routine in Debug.c (powers-of-ten subtraction plus a
+ * 16-bit divide and a two-digit table). Both are checked against
+ * sprintf, timed on the host, and their operations counted, since on
+ * a 68000 the number of 32-bit divides (each a library call) matters
+ * far more than host nanoseconds.
+ *
+ * Build and run:
+ *   cc -O2 -o numbench numbench.c && ./numbench
+ *
+ * The copies below use uint32_t/uint16_t to match the Mac's 32-bit
+ * long and 16-bit short. Keep NewFormat in step with FormatUnsigned.
+ *
+ * Copyright © 2026 Pascal Harris. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* Operation counts, per routine */
+static unsigned long gDiv32;    /* 32-bit divide or modulo: a library call on the 68000 */
+static unsigned long gSub32;    /* 32-bit compare-and-subtract steps */
+static unsigned long gDiv16;    /* 16-bit DIVU */
+
+/* Original DebugLogInt loop */
+static int OldFormat(char *out, uint32_t value)
+{
+    char numBuf[12];
+    int i = 0;
+    int j;
+
+    if (value == 0) {
+        numBuf[i++] = '0';
+    } else {
+        while (value > 0) {
+            numBuf[i++] = '0' + (char)(value % 10);
+            value /= 10;
+            gDiv32 += 2;
+        }
+    }
+    for (j = 0; j < i; j++) {
+        out[j] = numBuf[i - 1 - j];
+    }
+    return i;
+}
+
+/* Copy of FormatUnsigned from Debug.c, with counters */
+static const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static const uint32_t kPowersOfTen[] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL
+};
+
+static int NewFormat(char *out, uint32_t value)
+{
+    char *p = out;
+    const char *pair;
+    uint16_t low;
+    uint16_t high;
+    int i;
+    char digit;
+
+    if (value >= 10000UL) {
+        i = 0;
+        while (value < kPowersOfTen[i]) {
+            i++;
+            gSub32++;
+        }
+        for (; i < 6; i++) {
+            digit = '0';
+            while (value >= kPowersOfTen[i]) {
+                value -= kPowersOfTen[i];
+                digit++;
+                gSub32++;
+            }
+            gSub32++;
+            *p++ = digit;
+        }
+
+        low = (uint16_t)value;
+        high = low / 100;
+        low -= high * 100;
+        gDiv16++;
+        pair = &kDigitPairs[high * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+        pair = &kDigitPairs[low * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+        return (int)(p - out);
+    }
+
+    low = (uint16_t)value;
+    high = low / 100;
+    low -= high * 100;
+    gDiv16++;
+    if (high != 0) {
+        pair = &kDigitPairs[high * 2];
+        if (high >= 10) *p++ = pair[0];
+        *p++ = pair[1];
+        pair = &kDigitPairs[low * 2];
+        *p++ = pair[0];
+        *p++ = pair[1];
+    } else {
+        pair = &kDigitPairs[low * 2];
+        if (low >= 10) *p++ = pair[0];
+        *p++ = pair[1];
+    }
+    return (int)(p - out);
+}
+
+/* Simple repeatable value generator (xorshift) */
+static uint32_t gSeed = 2463534242UL;
+
+static uint32_t NextValue(void)
+{
+    gSeed ^= gSeed << 13;
+    gSeed ^= gSeed >> 17;
+    gSeed ^= gSeed << 5;
+    return gSeed;
+}
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Check both routines against sprintf */
+static int Verify(void)
+{
+    char expect[16];
+    char got[16];
+    int len;
+    uint32_t v;
+    uint32_t i;
+    int failures = 0;
+    static const uint32_t edges[] = {
+        0, 1, 9, 10, 99, 100, 999, 1000, 9999, 10000, 10001, 65535, 65536,
+        99999, 100000, 999999999UL, 1000000000UL, 4294967295UL
+    };
+
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]) + 2000000; i++) {
+        v = (i < sizeof(edges) / sizeof(edges[0])) ? edges[i] : NextValue() >> (i % 32);
+        sprintf(expect, "%lu", (unsigned long)v);
+
+        len = OldFormat(got, v);
+        got[len] = '\0';
+        if (strcmp(got, expect) != 0) {
+            printf("OldFormat(%s) gave %s\n", expect, got);
+            failures++;
+        }
+
+        len = NewFormat(got, v);
+        got[len] = '\0';
+        if (strcmp(got, expect) != 0) {
+            printf("NewFormat(%s) gave %s\n", expect, got);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/* Time and count one routine over a set of values */
+static void Run(const char *label, int (*format)(char *, uint32_t),
+                const uint32_t *values, long count, int rounds)
+{
+    char out[16];
+    volatile int sink = 0;
+    double start;
+    double elapsed;
+    long i;
+    int r;
+
+    gDiv32 = gSub32 = gDiv16 = 0;
+    start = NowSeconds();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < count; i++) {
+            sink += format(out, values[i]);
+        }
+    }
+    elapsed = NowSeconds() - start;
+
+    printf("  %-10s %6.1f ns/call   div32 %5.2f   sub32 %5.2f   div16 %4.2f\n",
+           label, elapsed * 1e9 / ((double)count * rounds),
+           (double)gDiv32 / ((double)count * rounds),
+           (double)gSub32 / ((double)count * rounds),
+           (double)gDiv16 / ((double)count * rounds));
+    (void)sink;
+}
+
+#define kValueCount 100000
+
+int main(void)
+{
+    static uint32_t values[kValueCount];
+    long i;
+
+    if (Verify() != 0) {
+        printf("Verification failed\n");
+        return 1;
+    }
+    printf("Verified against sprintf\n\n");
+
+    printf("Uniform 32-bit values (typically 10 digits):\n");
+    for (i = 0; i < kValueCount; i++) values[i] = NextValue();
+    Run("old loop", OldFormat, values, kValueCount, 50);
+    Run("new", NewFormat, values, kValueCount, 50);
+
+    printf("\nSmall values 0..9999 (counts, indices):\n");
+    for (i = 0; i < kValueCount; i++) values[i] = NextValue() % 10000;
+    Run("old loop", OldFormat, values, kValueCount, 50);
+    Run("new", NewFormat, values, kValueCount, 50);
+
+    printf("\nTick counts, 6-7 digits:\n");
+    for (i = 0; i < kValueCount; i++) values[i] = 100000 + NextValue() % 9000000;
+    Run("old loop", OldFormat, values, kValueCount, 50);
+    Run("new", NewFormat, values, kValueCount, 50);
+
+    printf("\ndiv32 = 32-bit divides per call (a library call each on the 68000),\n"
+           "sub32 = 32-bit compare/subtract steps, div16 = 16-bit DIVU per call.\n");
+    return 0;
+}
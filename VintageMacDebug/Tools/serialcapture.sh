@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+#
+# serialcapture.sh
+#
+# Captures a log sent by Debug.c's serial sinks (kDebugSinkModem,
+# kDebugSinkPrinter). Reads from a serial device, turns the Mac's CR
+# line endings into LF, and writes the text to standard output or a
+# file. With -p, makes a pseudo-terminal instead, for an emulator whose
+# serial port can be pointed at a host device.
+#
+
+############################################
+# HELP
+############################################
+show_help() {
+    cat <<EOF
+Usage: $0 [options] device
+       $0 [options] -p
+
+Options:
+  -b baud   Line speed (default 57600, matching serialConfig's default)
+  -o file   Append the log to file as well as showing it
+  -p        Create a pseudo-terminal and print its name, instead of
+            opening a device (needs socat)
+  -r        Keep CR line endings (raw capture)
+  -h        Show this help
+
+Stop with Control-C.
+EOF
+}
+
+############################################
+# ARGUMENT PARSING
+############################################
+baud=57600
+out_file=""
+use_pty=0
+raw=0
+
+while getopts "b:o:prh" opt; do
+    case "$opt" in
+        b) baud="$OPTARG" ;;
+        o) out_file="$OPTARG" ;;
+        p) use_pty=1 ;;
+        r) raw=1 ;;
+        h) show_help; exit 0 ;;
+        *) show_help; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [[ $use_pty -eq 0 && $# -ne 1 ]]; then
+    echo "No device specified."
+    show_help
+    exit 1
+fi
+
+############################################
+# DEPENDENCY CHECK
+############################################
+required_tools=(stty perl tee)
+[[ $use_pty -eq 1 ]] && required_tools+=(socat)
+
+missing=()
+for tool in "${required_tools[@]}"; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        missing+=("$tool")
+    fi
+done
+
+if [[ ${#missing[@]} -gt 0 ]]; then
+    echo "Missing required tools:"
+    for m in "${missing[@]}"; do echo "  - $m"; done
+    echo "Aborting."
+    exit 1
+fi
+
+############################################
+# CAPTURE
+############################################
+# Line at a time, so the log can be watched as it arrives
+convert() {
+    if [[ $raw -eq 1 ]]; then
+        cat
+    else
+        perl -e '$| = 1; $/ = "\r"; while (<STDIN>) { s/\r$/\n/; print; }'
+    fi
+}
+
+record() {
+    if [[ -n "$out_file" ]]; then
+        tee -a "$out_file"
+    else
+        cat
+    fi
+}
+
+if [[ $use_pty -eq 1 ]]; then
+    link="${TMPDIR:-/tmp}/debuglog-pty.$$"
+    echo "Serial port: $link" >&2
+    socat -u "pty,raw,echo=0,link=$link" - | convert | record
+    exit $?
+fi
+
+device="$1"
+if [[ ! -r "$device" ]]; then
+    echo "$device - cannot read"
+    exit 1
+fi
+
+# 8 data bits, 1 stop bit, no parity, no handshaking
+if ! stty -F "$device" "$baud" cs8 -cstopb -parenb -crtscts -ixon -ixoff raw -echo; then
+    echo "$device - cannot set $baud baud"
+    exit 1
+fi
+
+convert < "$device" | record